@@ -0,0 +1,284 @@
+// Micro- and macro-benchmarks for the environment and learner hot paths.
+//
+//   RLPathFindingBench [--out FILE] [--min-time SECONDS] [--filter SUBSTRING]
+//
+// Every case runs until it has used at least --min-time of wall clock (after a
+// short warm-up) and is reported as ns/op and ops/s. Results are written as JSON
+// to stdout or FILE, one entry per (name, param) pair, for regression tracking.
+#include <torch/torch.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ml/RL.hpp"
+#include "environment/Env.hpp"
+#include "../config/Config.h"
+
+using namespace project::common;
+using namespace project::env;
+using namespace rl;
+
+namespace {
+
+template <typename T>
+void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+    std::string name;
+    int64_t param;
+    int64_t iterations;
+    double ns_per_op;
+};
+
+class Harness {
+public:
+    Harness(double min_time, std::string filter) : min_time_(min_time), filter_(std::move(filter)) {}
+
+    // fn(n) must perform n operations of the measured kind.
+    void run(const std::string& name, int64_t param, const std::function<void(int64_t)>& fn) {
+        if (!filter_.empty() && name.find(filter_) == std::string::npos) return;
+
+        using clock = std::chrono::steady_clock;
+        int64_t n = 1;
+        double elapsed = 0.0;
+        fn(1);
+        for (;;) {
+            auto t0 = clock::now();
+            fn(n);
+            elapsed = std::chrono::duration<double>(clock::now() - t0).count();
+            if (elapsed >= min_time_) break;
+            double scale = elapsed > 0.0 ? min_time_ * 1.2 / elapsed : 10.0;
+            n = std::max<int64_t>(n + 1, static_cast<int64_t>(n * std::min(scale, 10.0)));
+        }
+
+        Result r{name, param, n, elapsed * 1e9 / n};
+        std::fprintf(stderr, "%-28s %10lld %14.1f ns/op %14.1f ops/s\n",
+                     r.name.c_str(), static_cast<long long>(r.param), r.ns_per_op, 1e9 / r.ns_per_op);
+        results_.push_back(r);
+    }
+
+    std::string json() const {
+        std::ostringstream out;
+        out << "{\n  \"context\": {\"torch_threads\": " << torch::get_num_threads()
+            << ", \"min_time\": " << min_time_ << "},\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const Result& r = results_[i];
+            out << "    {\"name\": \"" << r.name << "\", \"param\": " << r.param
+                << ", \"iterations\": " << r.iterations
+                << ", \"ns_per_op\": " << r.ns_per_op
+                << ", \"ops_per_sec\": " << 1e9 / r.ns_per_op << "}"
+                << (i + 1 < results_.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+        return out.str();
+    }
+
+private:
+    double min_time_;
+    std::string filter_;
+    std::vector<Result> results_;
+};
+
+std::vector<Box> random_boxes(size_t count, std::mt19937& rng) {
+    std::uniform_real_distribution<float> pos(0.0f, project::config::WORLD_WIDTH);
+    std::uniform_real_distribution<float> size(0.5f, 4.0f);
+    std::vector<Box> boxes;
+    boxes.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        boxes.emplace_back(pos(rng), pos(rng), size(rng), size(rng));
+    }
+    return boxes;
+}
+
+void fill_random(ReplayBuffer& buffer, size_t count, std::mt19937& rng) {
+    std::normal_distribution<float> dist;
+    float s[TOTAL_OBS_SIZE], a[ACT_SIZE], s2[TOTAL_OBS_SIZE];
+    for (size_t i = 0; i < count; ++i) {
+        for (float& v : s) v = dist(rng);
+        for (float& v : a) v = dist(rng);
+        for (float& v : s2) v = dist(rng);
+        buffer.push(s, a, dist(rng), s2, i % 100 == 0);
+    }
+}
+
+void bench_geometry(Harness& h) {
+    std::mt19937 rng(42);
+    Box box(50.0f, 50.0f, 10.0f, 10.0f);
+    h.run("box_get_intersect", 1, [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            float t = box.get_intersect(20.0f, 40.0f + (i & 7), {0.9f, 0.1f});
+            do_not_optimize(t);
+        }
+    });
+
+    Agent agent(project::config::WORLD_WIDTH / 2, project::config::WORLD_HEIGHT / 2);
+    std::array<std::pair<float, float>, SIZE_OF_ARRAY_OF_OBSERVATIONS> inters;
+    for (size_t count : {4, 16, 64, 256, 1024, 4096}) {
+        auto boxes = random_boxes(count, rng);
+        UniformGrid grid{BoxBounds(boxes)};
+        h.run("launch_rays_linear", count, [&](int64_t n) {
+            for (int64_t i = 0; i < n; ++i) {
+                auto d = agent.launch_rays(boxes, inters);
+                do_not_optimize(d);
+            }
+        });
+        h.run("launch_rays_grid", count, [&](int64_t n) {
+            for (int64_t i = 0; i < n; ++i) {
+                auto d = agent.launch_rays(grid);
+                do_not_optimize(d);
+            }
+        });
+    }
+}
+
+void bench_environment(Harness& h) {
+    Environment env = project::config::env;
+    Action action{{0.6f, 0.8f}, 1.0f};
+    float obs[TOTAL_OBS_SIZE];
+
+    h.run("env_reset", 1, [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            auto s = env.reset();
+            do_not_optimize(s);
+        }
+    });
+    // Step a few times from reset so the agent stays clear of the obstacles.
+    h.run("env_do_action", 1, [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            if (i % 8 == 0) env.reset();
+            auto s = env.do_action(action);
+            do_not_optimize(s);
+        }
+    });
+    h.run("env_step_compact", 1, [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            if (i % 8 == 0) env.restart();
+            auto s = env.step(action, obs);
+            do_not_optimize(s);
+        }
+    });
+}
+
+void bench_replay(Harness& h) {
+    std::mt19937 rng(42);
+    float s[TOTAL_OBS_SIZE] = {}, a[ACT_SIZE] = {}, s2[TOTAL_OBS_SIZE] = {};
+
+    ReplayBuffer push_buffer(100000);
+    h.run("replay_push", 1, [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            push_buffer.push(s, a, 1.0f, s2, false);
+        }
+    });
+
+    for (size_t fill : {10000, 100000, 1000000}) {
+        ReplayBuffer buffer(fill);
+        fill_random(buffer, fill, rng);
+        h.run("replay_sample_b512", fill, [&](int64_t n) {
+            for (int64_t i = 0; i < n; ++i) {
+                auto b = buffer.sample(512);
+                do_not_optimize(b.state);
+            }
+        });
+        ReplayBuffer per(fill, true);
+        fill_random(per, fill, rng);
+        h.run("replay_sample_per_b512", fill, [&](int64_t n) {
+            for (int64_t i = 0; i < n; ++i) {
+                auto b = per.sample(512);
+                do_not_optimize(b.state);
+            }
+        });
+    }
+}
+
+void bench_agent(Harness& h) {
+    std::mt19937 rng(42);
+    const float max_distance = project::config::env.get_max_distance();
+    TD3Agent agent(project::config::ACTOR_LR, project::config::CRITIC_LR,
+                   project::config::GAMMA, project::config::TAU, max_distance);
+    Environment env = project::config::env;
+    State s = env.reset();
+
+    h.run("preprocess_state", 1, [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            auto t = agent.preprocess_state(s);
+            do_not_optimize(t);
+        }
+    });
+
+    auto state = agent.preprocess_state(s);
+    h.run("select_action", 1, [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            auto a = agent.select_action(state, 0.1f);
+            do_not_optimize(a.first);
+        }
+    });
+
+    NativeActor native = agent.native_actor();
+    float obs[TOTAL_OBS_SIZE], act[ACT_SIZE];
+    env.restart(obs);
+    h.run("native_actor_forward", 1, [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            native.forward(obs, act);
+            do_not_optimize(act[0]);
+        }
+    });
+
+    ReplayBuffer buffer(20000);
+    fill_random(buffer, 20000, rng);
+    for (int batch : {64, 256, 1024, 4096}) {
+        h.run("td3_update", batch, [&](int64_t n) {
+            for (int64_t i = 0; i < n; ++i) {
+                agent.update(buffer, batch);
+            }
+        });
+    }
+    agent.set_scripted_target(true);
+    for (int batch : {64, 256, 1024, 4096}) {
+        h.run("td3_update_scripted", batch, [&](int64_t n) {
+            for (int64_t i = 0; i < n; ++i) {
+                agent.update(buffer, batch);
+            }
+        });
+    }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string out_path;
+    std::string filter;
+    double min_time = 0.5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            min_time = std::stod(argv[++i]);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        }
+    }
+
+    torch::manual_seed(42);
+    Harness h(min_time, filter);
+    bench_geometry(h);
+    bench_environment(h);
+    bench_replay(h);
+    bench_agent(h);
+
+    if (out_path.empty()) {
+        std::cout << h.json();
+    } else {
+        std::ofstream(out_path) << h.json();
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "Settings.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "Config.h"
+
+namespace project::config {
+
+namespace {
+
+std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+std::vector<float> parse_floats(const std::string& key, const std::string& value, size_t expected) {
+    std::vector<float> out;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t used = 0;
+        std::string t = trim(item);
+        float v = std::stof(t, &used);
+        if (used != t.size()) throw std::invalid_argument(t);
+        out.push_back(v);
+    }
+    if (out.size() != expected) {
+        throw std::runtime_error(key + " expects " + std::to_string(expected) + " numbers, got '" + value + "'");
+    }
+    return out;
+}
+
+Settings::Rect box_rect(const env::Box& b) {
+    auto [x, y] = b.get_coords();
+    auto [w, h] = b.get_w_h();
+    return {x, y, w, h};
+}
+
+}
+
+Settings Settings::defaults() {
+    Settings s;
+    s.world_width = WORLD_WIDTH;
+    s.world_height = WORLD_HEIGHT;
+    s.episodes = EPISODES;
+    s.max_steps = MAX_STEPS;
+    s.batch_size = BATCH_SIZE;
+    s.log_interval = LOG_INTERVAL;
+    s.actor_lr = ACTOR_LR;
+    s.critic_lr = CRITIC_LR;
+    s.gamma = GAMMA;
+    s.tau = TAU;
+    s.train_start_size = TRAIN_START_SIZE;
+    s.train_interval = TRAIN_INTERVAL;
+    s.utd_ratio = 0.0f;
+    s.updates_per_sample = 1;
+    s.agent = init_agent.get_coords();
+    s.goal = box_rect(config::goal);
+    for (const env::Box& b : config::obstacles) {
+        s.obstacles.push_back(box_rect(b));
+    }
+    return s;
+}
+
+void Settings::set(const std::string& qualified, const std::string& value) {
+    std::string key = qualified.find('.') == std::string::npos ? "train." + qualified : qualified;
+    try {
+        auto as_int = [&] {
+            size_t used = 0;
+            int v = std::stoi(value, &used);
+            if (used != value.size() || v < 1) throw std::invalid_argument(value);
+            return v;
+        };
+        auto as_float = [&] { return parse_floats(key, value, 1)[0]; };
+        auto as_positive = [&] {
+            float v = as_float();
+            if (!(v > 0.0f)) throw std::invalid_argument(value);
+            return v;
+        };
+
+        if (key == "world.width") world_width = as_positive();
+        else if (key == "world.height") world_height = as_positive();
+        else if (key == "train.episodes") episodes = as_int();
+        else if (key == "train.max_steps") max_steps = as_int();
+        else if (key == "train.batch_size") batch_size = as_int();
+        else if (key == "train.log_interval") log_interval = as_int();
+        else if (key == "train.actor_lr") actor_lr = as_positive();
+        else if (key == "train.critic_lr") critic_lr = as_positive();
+        else if (key == "train.gamma") gamma = as_float();
+        else if (key == "train.tau") tau = as_float();
+        else if (key == "train.train_start_size") train_start_size = as_int();
+        else if (key == "train.train_interval") train_interval = as_int();
+        else if (key == "train.utd_ratio") utd_ratio = as_float();
+        else if (key == "train.updates_per_sample") updates_per_sample = as_int();
+        else if (key == "map.agent") {
+            auto v = parse_floats(key, value, 2);
+            agent = {v[0], v[1]};
+        } else if (key == "map.goal") {
+            auto v = parse_floats(key, value, 4);
+            goal = {v[0], v[1], v[2], v[3]};
+        } else if (key == "map.obstacle") {
+            auto v = parse_floats(key, value, 4);
+            if (!obstacles_overridden) {
+                obstacles.clear();
+                obstacles_overridden = true;
+            }
+            obstacles.push_back({v[0], v[1], v[2], v[3]});
+        } else {
+            throw std::runtime_error("unknown setting " + key);
+        }
+    } catch (const std::logic_error&) {
+        throw std::runtime_error("invalid value for " + key + ": '" + value + "'");
+    }
+}
+
+void Settings::set(const std::string& assignment) {
+    size_t eq = assignment.find('=');
+    if (eq == std::string::npos) {
+        throw std::runtime_error("expected key=value, got '" + assignment + "'");
+    }
+    set(trim(assignment.substr(0, eq)), trim(assignment.substr(eq + 1)));
+}
+
+void Settings::load_ini(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("cannot open config " + path);
+    }
+    std::string line, section;
+    for (int n = 1; std::getline(in, line); ++n) {
+        line = trim(line.substr(0, line.find_first_of(";#")));
+        if (line.empty()) continue;
+        if (line.front() == '[') {
+            if (line.back() != ']') {
+                throw std::runtime_error(path + ":" + std::to_string(n) + ": malformed section header");
+            }
+            section = trim(line.substr(1, line.size() - 2));
+            continue;
+        }
+        size_t eq = line.find('=');
+        if (eq == std::string::npos || section.empty()) {
+            throw std::runtime_error(path + ":" + std::to_string(n) + ": expected key = value inside a section");
+        }
+        try {
+            set(section + "." + trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(path + ":" + std::to_string(n) + ": " + e.what());
+        }
+    }
+}
+
+float Settings::update_ratio() const {
+    return utd_ratio > 0.0f ? utd_ratio : 1.0f / std::max(1, train_interval);
+}
+
+env::Environment Settings::make_environment() const {
+    std::vector<env::Box> boxes;
+    for (const Rect& r : obstacles) {
+        boxes.emplace_back(r.x, r.y, r.w, r.h);
+    }
+    return env::Environment(
+        boxes,
+        env::Goal(goal.x, goal.y, goal.w, goal.h),
+        env::Agent(agent.first, agent.second),
+        0.0f, 0.0f,
+        world_width, world_height
+    );
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "environment/Env.hpp"
+
+namespace project::config {
+
+// Runtime counterpart of Config.h: starts from the compiled-in defaults and can be
+// overridden from an INI file and from "section.key=value" strings (--set).
+//
+//   [world]   width, height
+//   [train]   episodes, max_steps, batch_size, log_interval, actor_lr, critic_lr,
+//             gamma, tau, train_start_size, train_interval, utd_ratio,
+//             updates_per_sample
+//   [map]     agent = x, y
+//             goal = x, y, w, h
+//             obstacle = x, y, w, h     (repeat the key once per box)
+//
+// The first obstacle given by a file or override replaces the default map's
+// obstacles; later ones are appended. Integer [train] keys must be at least 1 and
+// world sizes and learning rates positive. Errors throw std::runtime_error.
+struct Settings {
+    struct Rect {
+        float x, y, w, h;
+    };
+
+    float world_width;
+    float world_height;
+
+    int episodes;
+    int max_steps;
+    int batch_size;
+    int log_interval;
+    float actor_lr;
+    float critic_lr;
+    float gamma;
+    float tau;
+    int train_start_size;
+    int train_interval;
+    // Gradient updates per collected transition; <= 0 means 1 / train_interval.
+    float utd_ratio;
+    // Updates run per sampled mega-batch (TD3Agent::update_batched).
+    int updates_per_sample;
+
+    std::pair<float, float> agent;
+    Rect goal;
+    std::vector<Rect> obstacles;
+
+    static Settings defaults();
+    void load_ini(const std::string& path);
+    // key is "section.key"; an unqualified key is looked up in [train].
+    void set(const std::string& key, const std::string& value);
+    // Parses "section.key=value".
+    void set(const std::string& assignment);
+    env::Environment make_environment() const;
+    float update_ratio() const;
+
+private:
+    bool obstacles_overridden = false;
+};
+
+}
@@ -6,9 +6,12 @@
 #include <array>
 #include <vector>
 #include <cmath>
+#include <memory>
 #include "Consts.hpp"
 #include "Types.hpp"
 #include "Enums.hpp"
+#include "RayCast.hpp"
+#include "SpatialGrid.hpp"
 
 namespace project::env{
 
@@ -18,16 +21,23 @@ namespace project::env{
 
     class Agent {
         float x, y;
-        std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> rdrs;
 
         float size;
     public:
         Agent(float x, float y);
         void shift(float u, float v);
-        std::pair<float, float> get_coords();
+        std::pair<float, float> get_coords() const;
+        static const RayDirs& directions();
         std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> launch_rays(
-            std::vector<Box> &objects_, std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> &inters
-        );
+            const std::vector<Box> &objects_, std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> &inters
+        ) const;
+        std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> launch_rays(
+            const UniformGrid &grid, std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> &inters
+        ) const;
+        std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> launch_rays(const UniformGrid &grid) const;
+        std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> intersections(
+            const std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> &dists
+        ) const;
     };
 
     class Object {
@@ -35,9 +45,9 @@ namespace project::env{
         float x, y;
     public:
         void set_coords(float n_x, float n_y);
-        std::pair<float, float> get_coords();
-        virtual bool check_colision(float o_x, float o_y);
-        virtual float get_intersect(float o_x, float o_y, std::pair<float, float> n_ray);
+        std::pair<float, float> get_coords() const;
+        virtual bool check_colision(float o_x, float o_y) const;
+        virtual float get_intersect(float o_x, float o_y, std::pair<float, float> n_ray) const;
         virtual ~Object() = default;
     };
 
@@ -45,42 +55,65 @@ namespace project::env{
         float w, h;
     public:
         Box(float x, float y, float w, float h);
-        std::pair<float, float> get_right_bottom();
-        std::pair<float, float> get_w_h();
-        bool check_colision(float o_x, float o_y) override;
-        float get_intersect(float o_x, float o_y, std::pair<float, float> n_ray) override;
+        std::pair<float, float> get_right_bottom() const;
+        std::pair<float, float> get_w_h() const;
+        bool check_colision(float o_x, float o_y) const override;
+        float get_intersect(float o_x, float o_y, std::pair<float, float> n_ray) const override;
     };
 
     class Goal : public Box {
     public:
-        std::pair<float, float> get_dir(float o_x, float o_y);
+        std::pair<float, float> get_dir(float o_x, float o_y) const;
         Goal(float x, float y, float w, float h)
             : Box(x, y, w, h) {}
-        float get_dist(float o_x, float o_y);
+        float get_dist(float o_x, float o_y) const;
     };
 
     class Environment {
-        struct Data{
+        // Obstacles never move, so everything static lives in one immutable block
+        // shared by every copy of the environment; an episode only owns the agent.
+        struct Geometry {
             std::vector<Box> objects_;
             Goal goal;
-            Agent agent;
             float bord_x0, bord_y0;
             float bord_x1, bord_y1;
+            UniformGrid grid;
+        };
+        struct Data{
+            Agent agent;
             float dtime = 0;
         };
+        std::shared_ptr<const Geometry> geo;
         Data cur;
         Data backup;
+
+        static std::shared_ptr<const Geometry> make_geometry(std::vector<Box> objects_, Goal goal,
+            float bord_x0, float bord_y0, float bord_x1, float bord_y1);
     public:
         Environment(std::vector<Box> objects_, Goal goal, Agent agent,
             float bord_x0, float bord_y0, float bord_x1, float bord_y1);
 
-        Goal* get_goal();
+        const Goal* get_goal() const;
         Agent* get_agent();
-        std::vector<Box>* get_objects();
-        std::pair<float, float> get_w_h();
+        const std::vector<Box>* get_objects() const;
+        std::pair<float, float> get_w_h() const;
+        float get_max_distance() const;
 
         common::State do_action(common::Action action);
         common::State reset();
+        // Training path: no ray hit points are produced. If obs is given, the
+        // normalised observation row (common::TOTAL_OBS_SIZE floats) is written
+        // into it, e.g. straight into tensor storage.
+        common::CompactState step(common::Action action, float* obs = nullptr);
+        common::CompactState restart(float* obs = nullptr);
+        void write_observation(const common::CompactState& st, float* obs) const;
+        // The one place observations are packed and normalised: rays, direction to
+        // goal, distance to goal / max_distance.
+        static void write_observation(const common::CompactState& st, float max_distance, float* obs);
+        // Ray hit points for the current agent position, for rendering.
+        std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> intersections(
+            const std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> &dists
+        ) const;
     };
 
 }
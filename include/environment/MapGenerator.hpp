@@ -0,0 +1,44 @@
+#ifndef MAPGENERATOR_H
+#define MAPGENERATOR_H
+
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Env.hpp"
+
+namespace project::env{
+
+    struct MapParams {
+        float width = 100.0f;
+        float height = 100.0f;
+        float density = 0.15f;          // summed obstacle area / world area
+        float min_size = 3.0f;          // obstacle side lengths are uniform in [min_size, max_size]
+        float max_size = 15.0f;
+        float goal_size = 5.0f;
+        float min_goal_distance = 40.0f;
+        float clearance = 2.0f;         // free margin around the start and the goal
+        float cell = 1.0f;              // resolution of the reachability check
+        int max_attempts = 100;
+    };
+
+    // Seeded random maps: axis-aligned boxes scattered until the requested density
+    // is reached, kept clear of the start and the goal. Every map is checked with
+    // a 4-connected BFS over a grid of `cell`-sized cells whose centres lie outside
+    // all obstacles and border walls (inflated by half a cell), so the goal is
+    // always reachable in unit steps. The same seed always yields the same map.
+    class MapGenerator {
+        MapParams params;
+
+        float spawn_lo(float size) const;
+        float spawn_hi(float size) const;
+        bool reachable(const Environment &env, std::pair<float, float> start) const;
+    public:
+        // Throws std::runtime_error if the parameters cannot produce a map.
+        explicit MapGenerator(MapParams params);
+        // Throws std::runtime_error if no reachable map is found in max_attempts.
+        Environment generate(uint64_t seed) const;
+    };
+
+}
+
+#endif
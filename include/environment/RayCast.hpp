@@ -0,0 +1,83 @@
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <array>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "Consts.hpp"
+
+namespace project::env{
+
+    class Box;
+
+    // Axis-aligned bounds of a set of boxes stored as separate arrays, so the
+    // slab test can load 4 (SSE) or 8 (AVX2) boxes per instruction.
+    struct BoxBounds {
+        std::vector<float> min_x, max_x, min_y, max_y;
+
+        BoxBounds() = default;
+        explicit BoxBounds(const std::vector<Box> &boxes);
+        void push_back(const Box &box);
+        size_t size() const;
+    };
+
+    // One axis of a ray prepared for slab tests. A direction component close to
+    // zero never crosses that slab, so the box is either hit along the whole ray
+    // or not at all, depending on whether the origin lies strictly between the planes.
+    struct Slab {
+        float o;
+        float inv;
+        bool degenerate;
+
+        Slab(float o, float d) : o(o), inv(1.0f / d), degenerate(std::abs(d) <= 0.000001f) {}
+
+        void range(float lo_b, float hi_b, float &lo, float &hi) const {
+            if (degenerate) {
+                bool inside = o > lo_b && o < hi_b;
+                lo = inside ? -INFINITY : INFINITY;
+                hi = inside ? INFINITY : -INFINITY;
+                return;
+            }
+            float t1 = (lo_b - o) * inv;
+            float t2 = (hi_b - o) * inv;
+            lo = std::min(t1, t2);
+            hi = std::max(t1, t2);
+        }
+    };
+
+    // Entry distance for a slab overlap, the exit distance if the origin is inside,
+    // INFINITY on a miss.
+    inline float slab_hit(float lo_x, float hi_x, float lo_y, float hi_y) {
+        float t_min = std::max(lo_x, lo_y);
+        float t_max = std::min(hi_x, hi_y);
+        if (t_max < t_min || t_max < 0) {
+            return INFINITY;
+        }
+        return t_min >= 0 ? t_min : t_max;
+    }
+
+    inline float intersect_box(const BoxBounds &b, size_t i, const Slab &sx, const Slab &sy) {
+        float lo_x, hi_x, lo_y, hi_y;
+        sx.range(b.min_x[i], b.max_x[i], lo_x, hi_x);
+        sy.range(b.min_y[i], b.max_y[i], lo_y, hi_y);
+        return slab_hit(lo_x, hi_x, lo_y, hi_y);
+    }
+
+    using RayDirs = std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS>;
+    using RayDists = std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS>;
+
+    // Distance along a unit ray from (o_x, o_y) to the closest box, or a negative
+    // value on a miss. Matches Box::get_intersect, including the exit distance when
+    // the origin is inside a box.
+    float intersect_boxes(const BoxBounds &bounds, float o_x, float o_y, std::pair<float, float> dir);
+    float intersect_boxes_scalar(const BoxBounds &bounds, float o_x, float o_y, std::pair<float, float> dir);
+
+    void cast_rays(const BoxBounds &bounds, float o_x, float o_y, const RayDirs &dirs, RayDists &res);
+
+}
+
+#endif
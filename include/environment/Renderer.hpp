@@ -3,8 +3,12 @@
 
 #pragma once
 #include <SFML/Graphics.hpp>
+#include <array>
+#include <atomic>
+#include <thread>
 #include <vector>
 #include "Env.hpp"
+#include "SpscQueue.hpp"
 
 namespace project::ren{
 
@@ -25,10 +29,36 @@ class DynamicRectangles {
 public:
     DynamicRectangles(env::Environment& env, bool addInters);
     void updateAgent(env::Agent* agent);
+    void updateAgent(std::pair<float, float> xy);
     void updateInters(common::State* state);
+    void updateInters(const std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS>& inters);
     void draw(sf::RenderTarget& target) const;
 };
 
+struct Snapshot {
+    std::pair<float, float> agent;
+    std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> inters;
+};
+
+// Owns the window on its own thread and draws snapshots handed over through a
+// lock-free SPSC queue, so the training loop never waits on vsync or the compositor.
+// When the queue is full the snapshot is dropped.
+class RenderThread {
+    env::Environment env_;
+    float width_;
+    float height_;
+    common::SpscQueue<Snapshot, 1024> queue_;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> open_{true};
+    std::thread thread_;
+    void loop();
+public:
+    RenderThread(const env::Environment& env, float width, float height);
+    ~RenderThread();
+    bool submit(const Snapshot& snapshot);
+    bool is_open() const;
+};
+
 }
 
 #endif
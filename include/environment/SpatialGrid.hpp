@@ -0,0 +1,38 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "RayCast.hpp"
+
+namespace project::env{
+
+    // Static uniform grid over a set of boxes. Each cell lists the boxes that
+    // overlap it (CSR layout), rays walk the cells with a DDA traversal and stop
+    // at the first cell whose exit lies beyond the closest hit found so far.
+    // Immutable after construction, so it can be shared between threads.
+    class UniformGrid {
+        BoxBounds bounds_;
+        float x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+        float cell = 1;
+        int nx = 0, ny = 0;
+        std::vector<uint32_t> cell_start;
+        std::vector<uint32_t> items;
+
+        int cell_x(float x) const;
+        int cell_y(float y) const;
+    public:
+        UniformGrid() = default;
+        explicit UniformGrid(BoxBounds bounds);
+
+        const BoxBounds& bounds() const;
+        float raycast(float o_x, float o_y, std::pair<float, float> dir) const;
+        void cast_rays(float o_x, float o_y, const RayDirs &dirs, RayDists &res) const;
+        bool check_colision(float o_x, float o_y) const;
+    };
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <torch/torch.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ml/RL.hpp"
+#include "environment/Env.hpp"
+
+namespace rl {
+
+    struct AsyncConfig {
+        size_t collectors = 2;
+        size_t envs_per_collector = 1;
+        int episodes = 0;
+        int max_steps = 0;
+        size_t batch_size = 0;
+        size_t train_start_size = 0;
+        size_t buffer_capacity = 0;
+        int sync_interval = 100;   // learner updates between actor weight publications
+        int log_interval = 0;
+        std::vector<int> collector_cpus;   // collector i is pinned to collector_cpus[i % size], if any
+        float update_ratio = 0.0f;         // learner updates per collected transition; 0 means unthrottled
+        int learner_threads = 0;           // libtorch intra-op threads for the learner; 0 leaves the setting alone
+        std::string telemetry_csv;         // with RLPF_TELEMETRY, appended to at every log_interval
+        std::string telemetry_json;
+    };
+
+    // Ape-X style split: collector threads step their own VecEnvironment with a
+    // private NativeActor copy and push into a ShardedReplayBuffer, while the
+    // calling thread runs TD3Agent::update, throttled to update_ratio updates per
+    // transition collected since training started. Every sync_interval updates
+    // the learner publishes a NativeActor snapshot of its actor; collectors copy
+    // it (sharing the weights) before their next step. Collector inference and
+    // exploration noise never touch libtorch, so each pinned collector runs on
+    // exactly one thread and libtorch's process-wide intra-op and BLAS threads are
+    // left to the learner.
+    class AsyncTrainer {
+    public:
+        AsyncTrainer(TD3Agent& agent, const project::env::Environment& env, AsyncConfig config, float max_distance);
+        void run();
+
+    private:
+        TD3Agent& agent_;
+        const project::env::Environment& env_;
+        AsyncConfig config_;
+        float max_distance_;
+
+        ShardedReplayBuffer buffer_;
+
+        std::shared_ptr<const NativeActor> published_;
+        std::mutex published_mutex_;
+        std::atomic<uint64_t> published_version_{0};
+
+        std::atomic<int> episodes_{0};
+        std::atomic<int64_t> env_steps_{0};
+        std::atomic<bool> stop_{false};
+
+        std::mutex stats_mutex_;
+        std::vector<float> episode_rewards_;
+        int success_count_ = 0;
+
+        void publish_actor();
+        void collect(size_t id);
+        void record_episode(float reward, bool success);
+    };
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include "ml/RL.hpp"
+
+namespace rl {
+
+    // Full training checkpoint: TD3Agent::save_checkpoint plus the training loop's
+    // progress, libtorch's default CPU generator (exploration noise) and the
+    // replay buffer's ring (ReplayBuffer::save_contents), sampling RNG and PER
+    // priorities. For a file-backed buffer only the ring position is stored: rows
+    // the file gained after the checkpoint are dropped on resume, but rows it
+    // overwrote once the ring was full cannot be brought back.
+    constexpr int64_t CHECKPOINT_VERSION = 3;
+
+    struct TrainingProgress {
+        int64_t episode = 0;        // episode to resume from
+        double update_credit = 0.0; // unspent update credit of the UTD schedule
+    };
+
+    // Serialises on the calling thread, which must be the one training the agent.
+    std::string serialize_checkpoint(TD3Agent& agent, const ReplayBuffer& buffer, const TrainingProgress& progress);
+    // Restores everything serialize_checkpoint wrote and returns the progress to
+    // resume from. Throws std::runtime_error on a missing or incompatible file.
+    TrainingProgress load_checkpoint(const std::string& path, TD3Agent& agent, ReplayBuffer& buffer);
+
+    // Writes serialized checkpoints from a background thread: the bytes go to
+    // path + ".tmp", which is then renamed over path, so a crash mid-write never
+    // leaves a truncated checkpoint. If a new checkpoint arrives before the
+    // previous one was written, the older one is dropped.
+    class CheckpointWriter {
+    public:
+        explicit CheckpointWriter(std::string path);
+        ~CheckpointWriter();
+        CheckpointWriter(const CheckpointWriter&) = delete;
+        CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+        void submit(std::string bytes);
+
+    private:
+        std::string path_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::optional<std::string> pending_;
+        bool stop_ = false;
+        std::thread thread_;
+
+        void run();
+    };
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include "ml/NativeActor.hpp"
+#include "environment/MapGenerator.hpp"
+
+namespace rl {
+
+    struct MapEvalConfig {
+        project::env::MapParams map;
+        uint64_t seed = 0;          // map i is generated from seed + i
+        size_t maps = 1000;
+        int max_steps = 500;
+        size_t threads = 1;
+    };
+
+    struct MapEvalReport {
+        size_t maps = 0;
+        size_t failed_maps = 0;         // no reachable map found for the seed; counted as failures
+        size_t successes = 0;
+        size_t collisions = 0;
+        int64_t steps = 0;
+        double path_length = 0.0;       // summed over successful episodes
+        double path_ratio = 0.0;        // path / straight-line start-goal distance, summed over successes
+        double seconds = 0.0;           // wall time, map generation included
+
+        double success_rate() const { return maps ? double(successes) / maps : 0.0; }
+        double mean_path_length() const { return successes ? path_length / successes : 0.0; }
+        double mean_path_ratio() const { return successes ? path_ratio / successes : 0.0; }
+        double steps_per_sec() const { return seconds > 0.0 ? steps / seconds : 0.0; }
+    };
+
+    // Runs one greedy episode of `actor` on each of config.maps generated maps,
+    // spread over a ThreadPool. Each map is generated and evaluated on the thread
+    // that owns it, with its own NativeActor copy, so nothing is shared but the
+    // weights. The result does not depend on the thread count. Throws
+    // std::runtime_error if config.map is invalid (see MapGenerator).
+    MapEvalReport evaluate_maps(const NativeActor& actor, const MapEvalConfig& config);
+
+}
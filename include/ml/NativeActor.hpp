@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rl {
+
+    // Frozen actor for inference without libtorch. The network is a stack of dense
+    // layers with ReLU between them and tanh on the output, as in ActorNetImpl.
+    //
+    // File layout (host byte order): uint32 magic "RLPA", uint32 version, uint32
+    // layer count, then per layer uint32 out, uint32 in, out*in row-major float
+    // weights and out float biases.
+    //
+    // Weights are shared between copies; each copy owns its scratch buffers, so use
+    // one copy per thread.
+    class NativeActor {
+    public:
+        struct Layer {
+            int out;
+            int in;
+            std::vector<float> weight;
+            std::vector<float> bias;
+        };
+
+        explicit NativeActor(std::vector<Layer> layers);
+        // Throws std::runtime_error unless the file holds a complete chain of
+        // layers from TOTAL_OBS_SIZE inputs to ACT_SIZE outputs.
+        static NativeActor load(const std::string& path);
+        void save(const std::string& path) const;
+
+        void forward(const float* obs, float* action) const;
+        const std::vector<Layer>& layers() const;
+        int input_size() const;
+        int output_size() const;
+
+    private:
+        std::shared_ptr<const std::vector<Layer>> layers_;
+        mutable std::vector<float> a_, b_;
+    };
+
+    // y = W x + b for a row-major [out, in] matrix, optionally followed by ReLU.
+    void dense_forward(const NativeActor::Layer& layer, const float* x, float* y, bool relu);
+
+}
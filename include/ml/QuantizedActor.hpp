@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ml/NativeActor.hpp"
+
+namespace rl {
+
+    // Post-training int8 version of a NativeActor. Weights are quantized
+    // symmetrically per output channel; each layer's input uses one static scale
+    // calibrated from the absolute maximum seen on a set of states. Products are
+    // accumulated in int32 and rescaled to float before bias, ReLU and tanh.
+    // Like NativeActor, use one copy per thread.
+    class QuantizedActor {
+    public:
+        struct Layer {
+            int out;
+            int in;
+            float input_scale;
+            std::vector<int8_t> weight;
+            std::vector<float> weight_scale;
+            std::vector<float> bias;
+        };
+
+        static QuantizedActor calibrate(const NativeActor& actor, const float* states, size_t count);
+
+        void forward(const float* obs, float* action) const;
+        size_t weight_bytes() const;
+
+    private:
+        std::vector<Layer> layers_;
+        mutable std::vector<int8_t> q_;
+        mutable std::vector<float> a_, b_;
+    };
+
+}
@@ -1,19 +1,26 @@
 #pragma once
 
 #include <torch/torch.h>
-#include <deque>
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
 #include <random>
 #include <utility>
 #include "Consts.hpp"
 #include "Enums.hpp"
+#include "ml/SumTree.hpp"
+#include "ml/ReplayFile.hpp"
+#include "ml/NativeActor.hpp"
 #include "environment/Env.hpp"
 
 namespace rl {
     constexpr int BASE_OBS_SIZE = project::common::SIZE_OF_ARRAY_OF_OBSERVATIONS;
-    constexpr int EXTRA_OBS_SIZE = 3;
-    constexpr int TOTAL_OBS_SIZE = BASE_OBS_SIZE + EXTRA_OBS_SIZE;
-    constexpr int ACT_SIZE = 2;
+    using project::common::EXTRA_OBS_SIZE;
+    using project::common::TOTAL_OBS_SIZE;
+    using project::common::ACT_SIZE;
+
+    void write_observation(const project::common::State& state, float max_distance, float* out);
 
     struct Transition {
         torch::Tensor state;
@@ -23,19 +30,111 @@ namespace rl {
         torch::Tensor done;
     };
 
+    struct Batch {
+        torch::Tensor state;      // [B, TOTAL_OBS_SIZE]
+        torch::Tensor action;     // [B, ACT_SIZE]
+        torch::Tensor reward;     // [B]
+        torch::Tensor next_state; // [B, TOTAL_OBS_SIZE]
+        torch::Tensor done;       // [B]
+        torch::Tensor indices;    // [B] rows in the buffer the batch came from
+        torch::Tensor weights;    // [B] importance-sampling weights, undefined for uniform sampling
+    };
+
+    // In prioritized mode transitions are drawn with probability proportional to
+    // priority^alpha (stratified over a sum tree) and come with importance-sampling
+    // weights (N * P(i))^-beta normalised by the batch maximum. beta starts at the
+    // constructor's value and anneal_beta moves it linearly to 1 over training, so
+    // the bias correction is complete by the end. New transitions get the largest
+    // priority seen so far.
+    //
+    // The path constructor keeps the ring in a ReplayFile instead of process memory
+    // and resumes from whatever the file already holds.
     class ReplayBuffer {
     public:
-        ReplayBuffer(size_t capacity);
+        ReplayBuffer(size_t capacity, bool prioritized = false, float alpha = 0.6f, float beta = 0.4f);
+        ReplayBuffer(const std::string& path, size_t capacity, bool prioritized = false,
+                     float alpha = 0.6f, float beta = 0.4f);
         void push(const Transition& transition);
-        std::vector<Transition> sample(size_t batch_size);
+        void push(const float* state, const float* action, float reward, const float* next_state, bool done);
+        Batch sample(size_t batch_size);
+        void update_priorities(const torch::Tensor& indices, const torch::Tensor& td_errors);
+        // progress is the fraction of training done, clamped to [0, 1].
+        void anneal_beta(double progress);
+        bool prioritized() const;
         size_t size() const;
+        torch::Tensor states() const;
+        std::string rng_state() const;
+        void set_rng_state(const std::string& state);
+        // PER state for checkpoints: the sum-tree leaves (priority^alpha) of the
+        // stored transitions, as a [size] double tensor, and the largest priority
+        // seen. set_priorities restores the first min(leaves, size) leaves.
+        torch::Tensor priorities() const;
+        float max_priority() const;
+        void set_priorities(const torch::Tensor& leaves, float max_priority);
+        // Ring state for checkpoints: capacity, size and pos, plus the stored rows
+        // for in-memory buffers. A file-backed buffer keeps its rows in the file and
+        // saves only size/pos; loading rewinds the file header to them. Loading
+        // throws std::runtime_error if the capacity differs, or if the checkpoint
+        // holds no rows and this buffer is not file-backed.
+        void save_contents(torch::serialize::OutputArchive& archive) const;
+        void load_contents(torch::serialize::InputArchive& archive);
 
     private:
-        std::deque<Transition> buffer;
+        ReplayBuffer(std::shared_ptr<ReplayFile> file, bool prioritized, float alpha, float beta);
+
+        std::shared_ptr<ReplayFile> file_;
+        // Structure-of-arrays ring: row i of every tensor belongs to the same transition.
+        torch::Tensor states_;
+        torch::Tensor actions_;
+        torch::Tensor rewards_;
+        torch::Tensor next_states_;
+        torch::Tensor dones_;
         size_t capacity_;
+        size_t size_ = 0;
+        size_t pos_ = 0;
         std::mt19937 rng;
+
+        bool prioritized_;
+        float alpha_;
+        float beta_start_;
+        float beta_;
+        float max_priority_ = 1.0f;
+        SumTree tree_;
     };
 
+    // Concurrent replay buffer made of independent ReplayBuffer shards, each behind
+    // its own mutex. Collector threads push into their own shard, so pushes never
+    // contend with each other; sample() locks one shard at a time while gathering
+    // its share of the batch. sample() must be called from a single thread and
+    // throws std::runtime_error while every shard is empty, as ReplayBuffer::sample
+    // does on an empty buffer.
+    class ShardedReplayBuffer {
+    public:
+        ShardedReplayBuffer(size_t capacity, size_t num_shards);
+        void push(size_t shard, const float* state, const float* action, float reward, const float* next_state, bool done);
+        Batch sample(size_t batch_size);
+        size_t size() const;
+
+    private:
+        struct Shard {
+            std::mutex mutex;
+            ReplayBuffer buffer;
+            std::atomic<size_t> size{0};
+            explicit Shard(size_t capacity) : buffer(capacity) {}
+        };
+        std::vector<std::unique_ptr<Shard>> shards_;
+        std::mt19937 rng;
+    };
+
+    torch::Tensor add_exploration_noise(torch::Tensor action, float noise_std);
+
+    // Re-homes every parameter of module as a view into one contiguous float buffer
+    // (in registration order) and returns that buffer. Two modules of the same type
+    // get identical layouts, so copying or blending whole networks becomes a single
+    // operation on the buffers. Loading weights rebinds parameters to new storage,
+    // so flatten again after torch::load / Module::load.
+    torch::Tensor flatten_parameters(torch::nn::Module& module);
+
     struct ActorNetImpl : torch::nn::Module {
         torch::nn::Linear fc1, fc2, fc3, fc4, fc5;
         ActorNetImpl();
@@ -52,13 +151,47 @@ namespace rl {
     };
     TORCH_MODULE(CriticNet);
 
+    // Both TD3 critics in one module. Each layer keeps the two heads' weights
+    // stacked as [2, out, in], so a single baddbmm evaluates both Q-values and one
+    // optimizer steps both. CriticNet stays the on-disk format for each head.
+    struct TwinCriticImpl : torch::nn::Module {
+        static constexpr int64_t HEADS = 2;
+        std::vector<torch::Tensor> weights;
+        std::vector<torch::Tensor> biases;
+        TwinCriticImpl();
+        torch::Tensor forward(torch::Tensor state, torch::Tensor action);
+        torch::Tensor q1(torch::Tensor state, torch::Tensor action);
+        void copy_weights(const TwinCriticImpl& source);
+        void load_head(int64_t head, const CriticNetImpl& critic);
+        void store_head(int64_t head, CriticNetImpl& critic) const;
+        void clip_grad_norm_per_head(double max_norm);
+    };
+    TORCH_MODULE(TwinCritic);
+
     class TD3Agent {
     public:
         TD3Agent(float actor_lr, float critic_lr, float gamma, float tau, float max_distance);
         std::pair<torch::Tensor, torch::Tensor> select_action(torch::Tensor state, float noise_std = 0.1f);
         void update(ReplayBuffer& buffer, int batch_size);
+        // Samples updates * batch_size transitions once, shuffles them and runs
+        // `updates` consecutive updates over batch_size slices (policy_delay still
+        // counts single updates). PER weights are normalised per slice; priorities
+        // are written back once, after the last slice.
+        void update_batched(ReplayBuffer& buffer, int batch_size, int updates);
+        torch::Tensor update(const Batch& batch);
+        // Computes the TD target (target actor, smoothing noise, twin target critics,
+        // min, discount) with a TorchScript function compiled once here instead of
+        // eager calls. The graph executor specialises it per batch shape on first
+        // use. The losses, backward passes and optimizer steps stay eager.
+        void set_scripted_target(bool enabled);
         void save_model(const std::string& actor_path, const std::string& critic1_path, const std::string& critic2_path);
         void load_model(const std::string& actor_path, const std::string& critic1_path, const std::string& critic2_path);
+        // Everything update() depends on: all four networks, both Adam states and
+        // the update counter.
+        void save_checkpoint(torch::serialize::OutputArchive& archive);
+        void load_checkpoint(torch::serialize::InputArchive& archive);
+        void export_actor(const std::string& path);
+        NativeActor native_actor();
         void set_eval_mode(bool eval);
         torch::Tensor preprocess_state(const project::common::State& state);
 
@@ -67,18 +200,26 @@ namespace rl {
 
     private:
         ActorNet actor_target;
-        CriticNet critic1, critic2;
-        CriticNet critic1_target, critic2_target;
+        TwinCritic critic;
+        TwinCritic critic_target;
 
         torch::optim::Adam actor_optimizer;
-        torch::optim::Adam critic1_optimizer;
-        torch::optim::Adam critic2_optimizer;
+        torch::optim::Adam critic_optimizer;
 
         float gamma;
         float tau;
         int policy_delay = 2;
         int update_step = 0;
 
-        void soft_update(torch::nn::Module& target, const torch::nn::Module& source);
+        std::vector<torch::Tensor> actor_params;
+        torch::Tensor actor_flat;
+        torch::Tensor actor_target_flat;
+        torch::Tensor critic_flat;
+        torch::Tensor critic_target_flat;
+
+        std::shared_ptr<torch::jit::CompilationUnit> target_script;
+
+        void flatten();
+        torch::Tensor target_value(const Batch& batch);
     };
 }
\ No newline at end of file
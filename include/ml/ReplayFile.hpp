@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rl {
+
+    // Replay storage in a memory-mapped file, so a buffer survives restarts and can
+    // be larger than RAM with the page cache deciding what stays resident.
+    //
+    // File layout (host byte order): a 4 KiB header page, then the columns of the
+    // ring one after another, each capacity rows long and starting on a 64-byte
+    // boundary: states [obs], actions [act], rewards [1], next states [obs],
+    // dones [1], all float32. The header records size and write position after
+    // every push, so reopening the file resumes the ring where it stopped.
+    class ReplayFile {
+    public:
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t obs_size;
+            uint32_t act_size;
+            uint64_t capacity;
+            uint64_t size;
+            uint64_t pos;
+        };
+
+        // Opens path, or creates it with room for capacity transitions. An existing
+        // file keeps its own capacity. Throws std::runtime_error on I/O errors, a
+        // layout that does not match obs_size/act_size or a header whose size/pos
+        // do not fit its capacity.
+        ReplayFile(const std::string& path, size_t capacity, uint32_t obs_size, uint32_t act_size);
+        ~ReplayFile();
+        ReplayFile(const ReplayFile&) = delete;
+        ReplayFile& operator=(const ReplayFile&) = delete;
+
+        Header& header();
+        size_t capacity() const;
+        float* states();
+        float* actions();
+        float* rewards();
+        float* next_states();
+        float* dones();
+
+    private:
+        int fd_ = -1;
+        void* base_ = nullptr;
+        size_t bytes_ = 0;
+        size_t offsets_[5];
+
+        float* column(int i);
+    };
+
+}
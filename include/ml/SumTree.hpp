@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace rl {
+
+    // Array-based binary sum tree over a fixed number of leaves: node i holds the
+    // sum of nodes 2i and 2i+1, leaves start at index `leaves_`. Setting a leaf and
+    // finding the leaf that covers a given prefix mass are both O(log N).
+    class SumTree {
+    public:
+        explicit SumTree(size_t capacity = 0);
+        void set(size_t i, double priority);
+        double get(size_t i) const;
+        double total() const;
+        size_t find(double mass) const;
+
+    private:
+        size_t leaves_;
+        std::vector<double> nodes_;
+    };
+
+}
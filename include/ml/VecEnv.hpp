@@ -0,0 +1,56 @@
+#pragma once
+
+#include <torch/torch.h>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "Types.hpp"
+#include "Enums.hpp"
+#include "ThreadPool.hpp"
+#include "environment/Env.hpp"
+
+namespace rl {
+
+    struct StepReward {
+        float reward;
+        bool done;
+    };
+
+    StepReward compute_reward(const project::common::CompactState& prev, const project::common::CompactState& next, float max_distance);
+
+    struct VecStep {
+        torch::Tensor obs;      // [N, TOTAL_OBS_SIZE], observation to act on next (after auto-reset)
+        torch::Tensor next_obs; // [N, TOTAL_OBS_SIZE], observation reached by the action (before auto-reset)
+        torch::Tensor reward;   // [N]
+        torch::Tensor done;     // [N], 1 on terminal states
+        std::vector<project::common::EnvState> env_type;
+        std::vector<uint8_t> finished; // episode ended (done or step limit) and the env was reset
+    };
+
+    // Steps N environments in lockstep. With num_threads > 1 the environments are
+    // split over a fixed work-stealing pool and every worker writes straight into
+    // its rows of the output tensors. Outputs are double-buffered and preallocated:
+    // the result of a step stays valid until the step after next.
+    class VecEnvironment {
+    public:
+        VecEnvironment(const project::env::Environment& proto, size_t num_envs, int max_steps, float max_distance,
+                       size_t num_threads = 1, std::vector<int> worker_cpus = {});
+        torch::Tensor reset();
+        const VecStep& step(const torch::Tensor& actions);
+        size_t size() const;
+
+    private:
+        std::vector<project::env::Environment> envs_;
+        std::vector<project::common::CompactState> start_states_;
+        std::vector<int> steps_;
+        int max_steps_;
+        float max_distance_;
+
+        VecStep out_[2];
+        int cur_ = 0;
+        std::unique_ptr<project::common::ThreadPool> pool_;
+
+        void step_one(size_t i, const float* action, VecStep& res);
+    };
+
+}
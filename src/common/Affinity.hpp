@@ -0,0 +1,107 @@
+#pragma once
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+namespace project::common {
+
+// CPU topology and pinning helpers (Linux). NUMA nodes come from sysfs; on a
+// machine without /sys/devices/system/node everything is one node.
+
+// Parses a kernel range list such as "0-7,16-23" (cpu and node lists alike).
+inline std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        if (part.empty() || part == "\n") continue;
+        size_t dash = part.find('-');
+        int lo = std::stoi(part.substr(0, dash));
+        int hi = dash == std::string::npos ? lo : std::stoi(part.substr(dash + 1));
+        for (int c = lo; c <= hi; ++c) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+inline std::vector<int> allowed_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::vector<int> cpus;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+    }
+    return cpus;
+}
+
+// Allowed CPUs grouped by NUMA node, nodes without allowed CPUs dropped.
+inline std::vector<std::vector<int>> numa_nodes() {
+    std::vector<int> allowed = allowed_cpus();
+    std::vector<std::vector<int>> nodes;
+    // Node ids can have gaps (offlined nodes), so take them from the online list.
+    std::vector<int> online;
+    {
+        std::ifstream in("/sys/devices/system/node/online");
+        std::string list;
+        if (in && std::getline(in, list)) online = parse_cpu_list(list);
+    }
+    for (int n : online) {
+        std::ifstream in("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+        if (!in) continue;
+        std::string list;
+        std::getline(in, list);
+        std::vector<int> cpus;
+        for (int c : parse_cpu_list(list)) {
+            if (std::find(allowed.begin(), allowed.end(), c) != allowed.end()) cpus.push_back(c);
+        }
+        if (!cpus.empty()) nodes.push_back(cpus);
+    }
+    if (nodes.empty()) nodes.push_back(allowed);
+    return nodes;
+}
+
+inline bool pin_current_thread(const std::vector<int>& cpus) {
+    if (cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) CPU_SET(c, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// Split of the machine between the learner and `workers` pinned worker threads.
+// Workers get one CPU each, taken from the last node backwards; the learner gets
+// what is left of the first node (or of the whole machine if that is empty).
+// Memory first touched by a thread pinned to `learner` lands on the learner's node.
+struct CpuPlan {
+    std::vector<int> learner;
+    std::vector<int> workers;
+
+    static CpuPlan make(size_t workers) {
+        auto nodes = numa_nodes();
+        std::vector<int> all;
+        for (const auto& n : nodes) all.insert(all.end(), n.begin(), n.end());
+
+        CpuPlan plan;
+        size_t taken = std::min(workers, all.size() > 1 ? all.size() - 1 : 0);
+        plan.workers.assign(all.end() - taken, all.end());
+        auto free = [&](int c) {
+            return std::find(plan.workers.begin(), plan.workers.end(), c) == plan.workers.end();
+        };
+        for (int c : nodes.front()) {
+            if (free(c)) plan.learner.push_back(c);
+        }
+        if (plan.learner.empty()) {
+            for (int c : all) {
+                if (free(c)) plan.learner.push_back(c);
+            }
+        }
+        return plan;
+    }
+};
+
+}
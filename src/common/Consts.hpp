@@ -3,5 +3,10 @@
 namespace project::common {
 
 constexpr unsigned int SIZE_OF_ARRAY_OF_OBSERVATIONS = 14;
+// Ray distances, then direction to goal (x, y) and distance to goal / world diagonal.
+constexpr unsigned int EXTRA_OBS_SIZE = 3;
+constexpr unsigned int TOTAL_OBS_SIZE = SIZE_OF_ARRAY_OF_OBSERVATIONS + EXTRA_OBS_SIZE;
+// Action direction (x, y).
+constexpr unsigned int ACT_SIZE = 2;
 
 }
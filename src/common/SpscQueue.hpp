@@ -0,0 +1,41 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace project::common {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity must be a power of two; one slot is kept free to tell full from empty.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    std::array<T, Capacity> slots_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+
+public:
+    bool try_push(const T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) & (Capacity - 1);
+        if (next == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots_[tail] = item;
+        tail_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots_[head];
+        head_.store((head + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+};
+
+}
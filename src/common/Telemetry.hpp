@@ -0,0 +1,319 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Hot-path instrumentation. Build with RLPF_TELEMETRY defined (CMake option of the
+// same name) to enable it; otherwise the macros below expand to nothing.
+//
+//   RLPF_SCOPE("env_step");        // times the rest of the enclosing block
+//   RLPF_COUNT("env_steps", n);    // adds n to a counter
+//
+// Each thread accumulates into its own slot, so recording never takes a lock;
+// Telemetry::instance() merges the slots when a report is requested.
+#ifdef RLPF_TELEMETRY
+#define RLPF_TELEMETRY_CONCAT_(a, b) a##b
+#define RLPF_TELEMETRY_CONCAT(a, b) RLPF_TELEMETRY_CONCAT_(a, b)
+#define RLPF_SCOPE(name)                                                                          \
+    static const int RLPF_TELEMETRY_CONCAT(rlpf_probe_, __LINE__) =                               \
+        ::project::common::Telemetry::instance().probe(name);                                     \
+    ::project::common::ScopedTimer RLPF_TELEMETRY_CONCAT(rlpf_timer_, __LINE__)(                  \
+        RLPF_TELEMETRY_CONCAT(rlpf_probe_, __LINE__))
+#define RLPF_COUNT(name, n)                                                                       \
+    do {                                                                                          \
+        static const int rlpf_counter_ = ::project::common::Telemetry::instance().counter(name);  \
+        ::project::common::Telemetry::instance().add(rlpf_counter_, n);                           \
+    } while (0)
+#else
+#define RLPF_SCOPE(name)
+#define RLPF_COUNT(name, n) do {} while (0)
+#endif
+
+namespace project::common {
+
+class Telemetry {
+public:
+    static constexpr int MAX_PROBES = 32;
+    static constexpr int MAX_COUNTERS = 16;
+    // Latency histogram with four buckets per power of two of nanoseconds,
+    // i.e. percentiles are resolved to within ~19%.
+    static constexpr int SUB_BUCKETS = 4;
+    static constexpr int BUCKETS = 36 * SUB_BUCKETS;
+    static constexpr size_t MAX_TRACE_EVENTS = 1 << 20;
+
+    struct ProbeStats {
+        std::string name;
+        uint64_t count = 0;
+        uint64_t total_ns = 0;
+        double p50_ns = 0, p90_ns = 0, p99_ns = 0;
+    };
+
+    struct Report {
+        double seconds = 0;                 // since the previous report
+        std::vector<ProbeStats> probes;     // over the same window
+        std::vector<std::pair<std::string, uint64_t>> counters;
+        double rate(const std::string& counter) const {
+            for (const auto& [name, value] : counters) {
+                if (name == counter) return seconds > 0 ? value / seconds : 0.0;
+            }
+            return 0.0;
+        }
+    };
+
+    static Telemetry& instance() {
+        static Telemetry t;
+        return t;
+    }
+
+    int probe(const std::string& name) { return intern(probe_names_, name, MAX_PROBES); }
+    int counter(const std::string& name) { return intern(counter_names_, name, MAX_COUNTERS); }
+
+    void record(int probe, uint64_t start_ns, uint64_t dur_ns) {
+        Slot& s = slot();
+        bump(s.probes[probe].count, 1);
+        bump(s.probes[probe].total_ns, dur_ns);
+        bump(s.probes[probe].buckets[bucket(dur_ns)], 1);
+        if (tracing_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(s.trace_mutex);
+            if (s.trace.size() < MAX_TRACE_EVENTS) {
+                s.trace.push_back({probe, start_ns, dur_ns});
+            }
+        }
+    }
+
+    void add(int counter, uint64_t n) {
+        bump(slot().counters[counter], n);
+    }
+
+    // Trace events are only kept while tracing is on; write_trace dumps them.
+    void set_tracing(bool on) { tracing_.store(on, std::memory_order_relaxed); }
+
+    static uint64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Merges all threads and returns the activity since the previous call.
+    Report report() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Totals cur = totals();
+        uint64_t now = now_ns();
+        Report r;
+        r.seconds = (now - last_report_ns_) * 1e-9;
+        for (size_t p = 0; p < probe_names_.size(); ++p) {
+            ProbeStats ps;
+            ps.name = probe_names_[p];
+            ps.count = cur.probes[p].count - last_.probes[p].count;
+            if (ps.count == 0) continue;
+            ps.total_ns = cur.probes[p].total_ns - last_.probes[p].total_ns;
+            std::array<uint64_t, BUCKETS> hist;
+            for (int b = 0; b < BUCKETS; ++b) {
+                hist[b] = cur.probes[p].buckets[b] - last_.probes[p].buckets[b];
+            }
+            ps.p50_ns = percentile(hist, ps.count, 0.50);
+            ps.p90_ns = percentile(hist, ps.count, 0.90);
+            ps.p99_ns = percentile(hist, ps.count, 0.99);
+            r.probes.push_back(ps);
+        }
+        for (size_t c = 0; c < counter_names_.size(); ++c) {
+            r.counters.emplace_back(counter_names_[c], cur.counters[c] - last_.counters[c]);
+        }
+        last_ = cur;
+        last_report_ns_ = now;
+        return r;
+    }
+
+    // share is probe time over wall time, summed over threads, so it can exceed 100%.
+    static std::string format(const Report& r) {
+        std::ostringstream out;
+        out.precision(3);
+        for (const auto& [name, value] : r.counters) {
+            out << "  " << name << ": " << r.rate(name) << "/s\n";
+        }
+        for (const auto& p : r.probes) {
+            out << "  " << p.name << ": n=" << p.count
+                << " mean=" << p.total_ns / 1e3 / p.count << "us"
+                << " p50=" << p.p50_ns / 1e3 << "us"
+                << " p90=" << p.p90_ns / 1e3 << "us"
+                << " p99=" << p.p99_ns / 1e3 << "us"
+                << " share=" << 100.0 * p.total_ns * 1e-9 / r.seconds << "%\n";
+        }
+        return out.str();
+    }
+
+    // One row per probe; appends so successive reports form a time series.
+    static void append_csv(const std::string& path, const Report& r, int64_t step) {
+        bool fresh = !std::ifstream(path).good();
+        std::ofstream out(path, std::ios::app);
+        if (fresh) out << "step,probe,count,total_ns,p50_ns,p90_ns,p99_ns\n";
+        for (const auto& p : r.probes) {
+            out << step << ',' << p.name << ',' << p.count << ',' << p.total_ns << ','
+                << p.p50_ns << ',' << p.p90_ns << ',' << p.p99_ns << '\n';
+        }
+        for (const auto& [name, value] : r.counters) {
+            out << step << ',' << name << ',' << value << ",,,,\n";
+        }
+    }
+
+    // One JSON object per line (JSON Lines), one line per report.
+    static void append_json(const std::string& path, const Report& r, int64_t step) {
+        std::ofstream out(path, std::ios::app);
+        out << "{\"step\":" << step << ",\"seconds\":" << r.seconds << ",\"counters\":{";
+        for (size_t i = 0; i < r.counters.size(); ++i) {
+            out << (i ? "," : "") << '"' << r.counters[i].first << "\":" << r.counters[i].second;
+        }
+        out << "},\"probes\":[";
+        for (size_t i = 0; i < r.probes.size(); ++i) {
+            const auto& p = r.probes[i];
+            out << (i ? "," : "") << "{\"name\":\"" << p.name << "\",\"count\":" << p.count
+                << ",\"total_ns\":" << p.total_ns << ",\"p50_ns\":" << p.p50_ns
+                << ",\"p90_ns\":" << p.p90_ns << ",\"p99_ns\":" << p.p99_ns << '}';
+        }
+        out << "]}\n";
+    }
+
+    // Chrome trace-event format, loadable in chrome://tracing or Perfetto.
+    void write_trace(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ofstream out(path);
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        for (size_t t = 0; t < slots_.size(); ++t) {
+            std::lock_guard<std::mutex> trace_lock(slots_[t]->trace_mutex);
+            for (const TraceEvent& e : slots_[t]->trace) {
+                out << (first ? "" : ",") << "\n{\"name\":\"" << probe_names_[e.probe]
+                    << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << t
+                    << ",\"ts\":" << (e.start_ns - epoch_ns_) / 1e3
+                    << ",\"dur\":" << e.dur_ns / 1e3 << '}';
+                first = false;
+            }
+        }
+        out << "\n]}\n";
+    }
+
+private:
+    struct ProbeSlot {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> total_ns{0};
+        std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+    };
+    struct TraceEvent {
+        int probe;
+        uint64_t start_ns;
+        uint64_t dur_ns;
+    };
+    // Written only by its owning thread; the atomics let report() read while it runs.
+    struct Slot {
+        std::array<ProbeSlot, MAX_PROBES> probes;
+        std::array<std::atomic<uint64_t>, MAX_COUNTERS> counters{};
+        std::mutex trace_mutex;
+        std::vector<TraceEvent> trace;
+    };
+    struct ProbeTotals {
+        uint64_t count = 0;
+        uint64_t total_ns = 0;
+        std::array<uint64_t, BUCKETS> buckets{};
+    };
+    struct Totals {
+        std::array<ProbeTotals, MAX_PROBES> probes{};
+        std::array<uint64_t, MAX_COUNTERS> counters{};
+    };
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::vector<std::string> probe_names_;
+    std::vector<std::string> counter_names_;
+    std::atomic<bool> tracing_{false};
+    uint64_t epoch_ns_ = now_ns();
+    uint64_t last_report_ns_ = epoch_ns_;
+    Totals last_;
+
+    // Single writer per slot, so a plain load/store is enough and cheaper than fetch_add.
+    static void bump(std::atomic<uint64_t>& a, uint64_t n) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static int bucket(uint64_t ns) {
+        if (ns < SUB_BUCKETS) return static_cast<int>(ns);
+        int e = std::bit_width(ns) - 1;
+        int sub = static_cast<int>((ns >> (e - 2)) & (SUB_BUCKETS - 1));
+        return std::min(e * SUB_BUCKETS + sub, BUCKETS - 1);
+    }
+
+    static double bucket_upper(int b) {
+        if (b < SUB_BUCKETS) return b + 1;
+        int e = b / SUB_BUCKETS;
+        int sub = b % SUB_BUCKETS;
+        return static_cast<double>(uint64_t(SUB_BUCKETS + sub + 1) << (e - 2));
+    }
+
+    static double percentile(const std::array<uint64_t, BUCKETS>& hist, uint64_t count, double q) {
+        uint64_t rank = static_cast<uint64_t>(q * (count - 1)) + 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; ++b) {
+            seen += hist[b];
+            if (seen >= rank) return bucket_upper(b);
+        }
+        return bucket_upper(BUCKETS - 1);
+    }
+
+    int intern(std::vector<std::string>& names, const std::string& name, int limit) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (names[i] == name) return static_cast<int>(i);
+        }
+        if (static_cast<int>(names.size()) == limit) return limit - 1;
+        names.push_back(name);
+        return static_cast<int>(names.size()) - 1;
+    }
+
+    Slot& slot() {
+        thread_local Slot* s = nullptr;
+        if (!s) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            slots_.push_back(std::make_unique<Slot>());
+            s = slots_.back().get();
+        }
+        return *s;
+    }
+
+    Totals totals() const {
+        Totals t;
+        for (const auto& s : slots_) {
+            for (int p = 0; p < MAX_PROBES; ++p) {
+                t.probes[p].count += s->probes[p].count.load(std::memory_order_relaxed);
+                t.probes[p].total_ns += s->probes[p].total_ns.load(std::memory_order_relaxed);
+                for (int b = 0; b < BUCKETS; ++b) {
+                    t.probes[p].buckets[b] += s->probes[p].buckets[b].load(std::memory_order_relaxed);
+                }
+            }
+            for (int c = 0; c < MAX_COUNTERS; ++c) {
+                t.counters[c] += s->counters[c].load(std::memory_order_relaxed);
+            }
+        }
+        return t;
+    }
+};
+
+class ScopedTimer {
+    int probe_;
+    uint64_t start_;
+public:
+    explicit ScopedTimer(int probe) : probe_(probe), start_(Telemetry::now_ns()) {}
+    ~ScopedTimer() {
+        Telemetry::instance().record(probe_, start_, Telemetry::now_ns() - start_);
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+}
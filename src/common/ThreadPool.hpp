@@ -0,0 +1,151 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Affinity.hpp"
+
+namespace project::common {
+
+// Fixed pool for fork-join loops. parallel_for splits [0, n) evenly over the
+// caller and the workers; a slot that runs dry steals half of another slot's
+// remaining range. Each range is one packed atomic word, so neither the owner
+// nor a thief ever takes a lock. Only one thread may call parallel_for at a time.
+// If cpus is given, worker k is pinned to cpus[k % cpus.size()]; the caller's
+// affinity is left alone.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t num_threads, std::vector<int> cpus = {})
+        : num_slots_(std::max<size_t>(num_threads, 1)),
+          ranges_(std::make_unique<Range[]>(num_slots_)) {
+        for (size_t slot = 1; slot < num_slots_; ++slot) {
+            int cpu = cpus.empty() ? -1 : cpus[(slot - 1) % cpus.size()];
+            workers_.emplace_back([this, slot, cpu] {
+                if (cpu >= 0) pin_current_thread({cpu});
+                worker_loop(slot);
+            });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& w : workers_) {
+            w.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return num_slots_; }
+
+    void parallel_for(size_t n, const std::function<void(size_t)>& fn) {
+        for (size_t slot = 0; slot < num_slots_; ++slot) {
+            uint32_t b = static_cast<uint32_t>(n * slot / num_slots_);
+            uint32_t e = static_cast<uint32_t>(n * (slot + 1) / num_slots_);
+            ranges_[slot].bounds.store(pack(b, e), std::memory_order_relaxed);
+        }
+
+        std::latch done(static_cast<std::ptrdiff_t>(num_slots_));
+        {
+            std::lock_guard lock(mutex_);
+            job_ = &fn;
+            done_ = &done;
+            ++generation_;
+        }
+        cv_.notify_all();
+
+        run_slot(0, fn);
+        done.arrive_and_wait();
+    }
+
+private:
+    struct alignas(64) Range {
+        std::atomic<uint64_t> bounds{0};
+    };
+
+    size_t num_slots_;
+    std::unique_ptr<Range[]> ranges_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+    const std::function<void(size_t)>* job_ = nullptr;
+    std::latch* done_ = nullptr;
+
+    static uint64_t pack(uint32_t b, uint32_t e) {
+        return (static_cast<uint64_t>(b) << 32) | e;
+    }
+
+    bool pop_own(size_t slot, size_t& i) {
+        auto& r = ranges_[slot].bounds;
+        uint64_t cur = r.load(std::memory_order_acquire);
+        while (true) {
+            uint32_t b = static_cast<uint32_t>(cur >> 32);
+            uint32_t e = static_cast<uint32_t>(cur);
+            if (b >= e) return false;
+            if (r.compare_exchange_weak(cur, pack(b + 1, e), std::memory_order_acq_rel)) {
+                i = b;
+                return true;
+            }
+        }
+    }
+
+    bool steal(size_t thief, size_t& i) {
+        for (size_t k = 1; k < num_slots_; ++k) {
+            auto& r = ranges_[(thief + k) % num_slots_].bounds;
+            uint64_t cur = r.load(std::memory_order_acquire);
+            while (true) {
+                uint32_t b = static_cast<uint32_t>(cur >> 32);
+                uint32_t e = static_cast<uint32_t>(cur);
+                if (b >= e) break;
+                uint32_t mid = b + (e - b) / 2;
+                if (r.compare_exchange_weak(cur, pack(b, mid), std::memory_order_acq_rel)) {
+                    ranges_[thief].bounds.store(pack(mid + 1, e), std::memory_order_release);
+                    i = mid;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void run_slot(size_t slot, const std::function<void(size_t)>& fn) {
+        size_t i;
+        while (pop_own(slot, i) || steal(slot, i)) {
+            fn(i);
+        }
+    }
+
+    void worker_loop(size_t slot) {
+        uint64_t seen = 0;
+        while (true) {
+            const std::function<void(size_t)>* job;
+            std::latch* done;
+            {
+                std::unique_lock lock(mutex_);
+                cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+                job = job_;
+                done = done_;
+            }
+            run_slot(slot, *job);
+            done->count_down();
+        }
+    }
+};
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <utility>
 #include <array>
+#include <type_traits>
 #include "Enums.hpp"
 #include "Consts.hpp"
 
@@ -14,6 +15,17 @@ struct State {
     EnvState env_type;
 };
 
+// Training-path state: the State fields minus the ray hit points, which only the
+// renderer needs (see Environment::intersections). 72 bytes instead of 184.
+struct CompactState {
+    std::array<float, SIZE_OF_ARRAY_OF_OBSERVATIONS> obs;
+    std::array<float, 2> direction_to_goal;
+    float distance_to_goal;
+    EnvState env_type;
+};
+static_assert(std::is_trivially_copyable_v<CompactState>);
+static_assert(sizeof(CompactState) == (SIZE_OF_ARRAY_OF_OBSERVATIONS + 4) * sizeof(float));
+
 struct Action {
     std::pair<float, float> dir;
     float len;                  
@@ -3,11 +3,13 @@
 #include <array>
 #include <vector>
 #include <cmath>
+#include <algorithm>
 #include "Consts.hpp"
+#include "Telemetry.hpp"
 
 namespace project::env{
 
-float Object::get_intersect(float o_x, float o_y, std::pair<float, float> n_ray) {
+float Object::get_intersect(float o_x, float o_y, std::pair<float, float> n_ray) const {
     return -1.0f;
 }
 
@@ -19,31 +21,38 @@ float euclid(float a, float b) {
 Agent::Agent(float x, float y) {
     this->x = x;
     this->y = y;
-
-    float phi = 2 * acos(-1) / rdrs.size();
-    float theta = 0.0;
-    for (int i = 0; i < rdrs.size(); i++) {
-        rdrs[i] = {cos(theta), sin(theta)};
-        theta += phi;
-    }
+}
+const RayDirs& Agent::directions() {
+    static const RayDirs rdrs = [] {
+        RayDirs d;
+        float phi = 2 * acos(-1) / d.size();
+        float theta = 0.0;
+        for (int i = 0; i < d.size(); i++) {
+            d[i] = {cos(theta), sin(theta)};
+            theta += phi;
+        }
+        return d;
+    }();
+    return rdrs;
 }
 void Agent::shift(float u, float v) {
     this->x += u;
     this->y += v;
 }
-std::pair<float, float> Agent::get_coords() {
+std::pair<float, float> Agent::get_coords() const {
     return {this->x, this->y};
 }
 std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> Agent::launch_rays(
-    std::vector<Box> &objects_, std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> &inters
-) {
+    const std::vector<Box> &objects_, std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> &inters
+) const {
+    const RayDirs &rdrs = directions();
     std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> res;
     for (int i = 0; i < res.size(); i++) {
         res[i] = 0;
     }
     for (int i = 0; i < rdrs.size(); i++) {
         float d = INFINITY;
-        for (Box &o : objects_) {
+        for (const Box &o : objects_) {
             float t = o.get_intersect(x, y, rdrs[i]);
             if (t < 0) {
                 continue;
@@ -56,15 +65,41 @@ std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> Agent::launch_rays(
     return res;
 }
 
+std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> Agent::launch_rays(
+    const UniformGrid &grid, std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> &inters
+) const {
+    std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> res = launch_rays(grid);
+    inters = intersections(res);
+    return res;
+}
+
+std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> Agent::launch_rays(const UniformGrid &grid) const {
+    RLPF_SCOPE("ray_cast");
+    std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> res;
+    grid.cast_rays(x, y, directions(), res);
+    return res;
+}
+
+std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> Agent::intersections(
+    const std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> &dists
+) const {
+    const RayDirs &rdrs = directions();
+    std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> inters;
+    for (int i = 0; i < rdrs.size(); i++) {
+        inters[i] = {x + rdrs[i].first * dists[i], y + rdrs[i].second * dists[i]};
+    }
+    return inters;
+}
+
 void Object::set_coords(float n_x, float n_y) {
     this->x = n_x;
     this->y = n_y;
 }
-std::pair<float, float> Object::get_coords() {
+std::pair<float, float> Object::get_coords() const {
     return {this->x, this->y};
 }
 
-bool Object::check_colision(float o_x, float o_y) {
+bool Object::check_colision(float o_x, float o_y) const {
     return false;
 }
 
@@ -73,15 +108,15 @@ Box::Box(float x, float y, float w, float h) {
     this->w = w;
     this->h = h;
 }
-std::pair<float, float> Box::get_right_bottom() {
+std::pair<float, float> Box::get_right_bottom() const {
     float x = get_coords().first;
     float y = get_coords().second;
     return {x + w/2, y - h/2};
 }
-std::pair<float, float> Box::get_w_h() {
+std::pair<float, float> Box::get_w_h() const {
     return {w, h};
 }
-bool Box::check_colision(float o_x, float o_y) {
+bool Box::check_colision(float o_x, float o_y) const {
     float x = get_coords().first;
     float y = get_coords().second;
     if ((o_x > x - w/2) && (o_x < x + w/2) && (o_y > y - h/2) && (o_y < y + h/2)) {
@@ -89,7 +124,7 @@ bool Box::check_colision(float o_x, float o_y) {
     }
     return false;
 }
-float Box::get_intersect(float o_x, float o_y, std::pair<float, float> n_ray) {
+float Box::get_intersect(float o_x, float o_y, std::pair<float, float> n_ray) const {
     float x = get_coords().first;
     float y = get_coords().second;
     if (std::abs(n_ray.second) <= 0.000001) {
@@ -155,67 +190,94 @@ float Box::get_intersect(float o_x, float o_y, std::pair<float, float> n_ray) {
     }
 }
 
-std::pair<float, float> Goal::get_dir(float o_x, float o_y) {
+std::pair<float, float> Goal::get_dir(float o_x, float o_y) const {
     float x = get_coords().first;
     float y = get_coords().second;
     float norm = euclid(x - o_x, y - o_y);
     return {(o_x - x) / norm, (o_y - y) / norm};
 }
-float Goal::get_dist(float o_x, float o_y) {
+float Goal::get_dist(float o_x, float o_y) const {
     float x = get_coords().first;
     float y = get_coords().second;
     float norm = euclid(x - o_x, y - o_y);
     return norm;
 }
 
-Environment::Environment(std::vector<Box> objects_, Goal goal, Agent agent,
-        float bord_x0, float bord_y0, float bord_x1, float bord_y1) :
-        cur{
-            std::move(objects_),
-            std::move(goal),
-            std::move(agent),
-            bord_x0, bord_y0, bord_x1, bord_y1
-        },
-        backup{ cur }
-{
-    cur.objects_.push_back(Box(
+std::shared_ptr<const Environment::Geometry> Environment::make_geometry(std::vector<Box> objects_, Goal goal,
+        float bord_x0, float bord_y0, float bord_x1, float bord_y1) {
+    auto g = std::make_shared<Geometry>(Geometry{
+        std::move(objects_),
+        std::move(goal),
+        bord_x0, bord_y0, bord_x1, bord_y1
+    });
+    g->objects_.push_back(Box(
                             (bord_x0 + bord_x1) / 2,
                             bord_y1,
                             std::abs(bord_x0 - bord_x1) * 1.1,
                             std::abs(bord_y0 - bord_y1) / 10
                         ));
-    cur.objects_.push_back(Box(
+    g->objects_.push_back(Box(
                             (bord_x0 + bord_x1) / 2,
                             bord_y0,
                             std::abs(bord_x0 - bord_x1) * 1.1,
                             std::abs(bord_y0 - bord_y1) / 10
                         ));
-    cur.objects_.push_back(Box(
+    g->objects_.push_back(Box(
                             bord_x0,
                             (bord_y0 + bord_y1) / 2,
                             std::abs(bord_x0 - bord_x1) / 10,
                             std::abs(bord_y0 - bord_y1) * 1.1
                         ));
-    cur.objects_.push_back(Box(
+    g->objects_.push_back(Box(
                             bord_x1,
                             (bord_y0 + bord_y1) / 2,
                             std::abs(bord_x0 - bord_x1) / 10,
                             std::abs(bord_y0 - bord_y1) * 1.1
                         ));
-    backup = cur;
-}   
+    g->grid = UniformGrid(BoxBounds(g->objects_));
+    return g;
+}
 
-Goal* Environment::get_goal() {
-    return &cur.goal;
+Environment::Environment(std::vector<Box> objects_, Goal goal, Agent agent,
+        float bord_x0, float bord_y0, float bord_x1, float bord_y1) :
+        geo(make_geometry(std::move(objects_), std::move(goal), bord_x0, bord_y0, bord_x1, bord_y1)),
+        cur{ std::move(agent) },
+        backup{ cur }
+{
+}
+
+const Goal* Environment::get_goal() const {
+    return &geo->goal;
 }
 Agent* Environment::get_agent() {
     return &cur.agent;
 }
-std::vector<Box>* Environment::get_objects() {
-    return &cur.objects_;
+const std::vector<Box>* Environment::get_objects() const {
+    return &geo->objects_;
+}
+std::pair<float, float> Environment::get_w_h() const {
+    return {geo->bord_x1 - geo->bord_x1, geo->bord_y1 - geo->bord_y0};
+}
+
+float Environment::get_max_distance() const {
+    return euclid(geo->bord_x1 - geo->bord_x0, geo->bord_y1 - geo->bord_y0);
+}
+
+void Environment::write_observation(const common::CompactState& st, float* obs) const {
+    write_observation(st, get_max_distance(), obs);
+}
+
+void Environment::write_observation(const common::CompactState& st, float max_distance, float* obs) {
+    std::copy(st.obs.begin(), st.obs.end(), obs);
+    obs[common::SIZE_OF_ARRAY_OF_OBSERVATIONS] = st.direction_to_goal[0];
+    obs[common::SIZE_OF_ARRAY_OF_OBSERVATIONS + 1] = st.direction_to_goal[1];
+    obs[common::SIZE_OF_ARRAY_OF_OBSERVATIONS + 2] = st.distance_to_goal / max_distance;
 }
-std::pair<float, float> Environment::get_w_h() {
-    return {cur.bord_x1 - cur.bord_x1, cur.bord_y1 - cur.bord_y0};
+
+std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> Environment::intersections(
+    const std::array<float, common::SIZE_OF_ARRAY_OF_OBSERVATIONS> &dists
+) const {
+    return cur.agent.intersections(dists);
 }
 
 common::State Environment::reset() {
@@ -227,23 +289,44 @@ common::State Environment::reset() {
 }
 
 common::State Environment::do_action(common::Action action) {
+    common::CompactState cs = step(action);
     common::State st;
+    st.obs = cs.obs;
+    st.obs_intersect = cur.agent.intersections(cs.obs);
+    st.direction_to_goal = {cs.direction_to_goal[0], cs.direction_to_goal[1]};
+    st.distance_to_goal = cs.distance_to_goal;
+    st.env_type = cs.env_type;
+    return st;
+}
+
+common::CompactState Environment::restart(float* obs) {
+    this->cur = this->backup;
+    common::Action start;
+    start.dir = {0.0, 0.0};
+    start.len = 0.0;
+    return step(start, obs);
+}
+
+common::CompactState Environment::step(common::Action action, float* obs) {
+    RLPF_SCOPE("env_step");
+    RLPF_COUNT("env_steps", 1);
+    common::CompactState st;
     cur.agent.shift(action.dir.first * action.len, action.dir.second * action.len);
-    st.obs = cur.agent.launch_rays(cur.objects_, st.obs_intersect);
+    st.obs = cur.agent.launch_rays(geo->grid);
     std::pair<float, float> a_xy = cur.agent.get_coords();
-    st.direction_to_goal = cur.goal.get_dir(a_xy.first, a_xy.second);
-    st.distance_to_goal = cur.goal.get_dist(a_xy.first, a_xy.second);
-    for (Object &o : cur.objects_) {
-        if (o.check_colision(a_xy.first, a_xy.second)) {
-            st.env_type = common::EnvState::COLLISION;
-            return st;
-        }
-    }
-    if (cur.goal.check_colision(a_xy.first, a_xy.second)) {
+    std::pair<float, float> dir = geo->goal.get_dir(a_xy.first, a_xy.second);
+    st.direction_to_goal = {dir.first, dir.second};
+    st.distance_to_goal = geo->goal.get_dist(a_xy.first, a_xy.second);
+    if (geo->grid.check_colision(a_xy.first, a_xy.second)) {
+        st.env_type = common::EnvState::COLLISION;
+    } else if (geo->goal.check_colision(a_xy.first, a_xy.second)) {
         st.env_type = common::EnvState::TERMINAL;
-        return st;
+    } else {
+        st.env_type = common::EnvState::NONE;
+    }
+    if (obs) {
+        write_observation(st, obs);
     }
-    st.env_type = common::EnvState::NONE;
     return st;
 }
 
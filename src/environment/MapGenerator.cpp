@@ -0,0 +1,149 @@
+#include "MapGenerator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace project::env{
+
+namespace {
+
+bool inside(const Box &b, float x, float y, float margin) {
+    auto [bx, by] = b.get_coords();
+    auto [w, h] = b.get_w_h();
+    return std::abs(x - bx) < w / 2 + margin && std::abs(y - by) < h / 2 + margin;
+}
+
+bool overlaps(const Box &a, const Box &b, float margin) {
+    auto [ax, ay] = a.get_coords();
+    auto [aw, ah] = a.get_w_h();
+    auto [bx, by] = b.get_coords();
+    auto [bw, bh] = b.get_w_h();
+    return std::abs(ax - bx) < (aw + bw) / 2 + margin && std::abs(ay - by) < (ah + bh) / 2 + margin;
+}
+
+}
+
+// The border walls built by Environment reach 5% of the world size inwards; the
+// start and the goal keep `margin` clear of them.
+float MapGenerator::spawn_lo(float size) const {
+    return 0.05f * size + params.goal_size / 2 + params.clearance;
+}
+
+float MapGenerator::spawn_hi(float size) const {
+    return 0.95f * size - params.goal_size / 2 - params.clearance;
+}
+
+MapGenerator::MapGenerator(MapParams params) : params(params) {
+    auto fail = [](const std::string &what) { throw std::runtime_error("invalid map params: " + what); };
+    if (!(params.cell > 0.0f) || !(params.goal_size > 0.0f) || params.clearance < 0.0f) {
+        fail("cell and goal_size must be positive, clearance non-negative");
+    }
+    if (!(params.min_size > 0.0f) || !(params.min_size <= params.max_size)) {
+        fail("need 0 < min_size <= max_size");
+    }
+    if (params.density < 0.0f || params.max_attempts <= 0) {
+        fail("density must be non-negative and max_attempts positive");
+    }
+    float w = spawn_hi(params.width) - spawn_lo(params.width);
+    float h = spawn_hi(params.height) - spawn_lo(params.height);
+    if (!(w > 0.0f) || !(h > 0.0f)) {
+        fail("world too small for goal_size and clearance");
+    }
+    if (!(params.min_goal_distance < std::hypot(w, h))) {
+        fail("min_goal_distance does not fit in the world");
+    }
+}
+
+bool MapGenerator::reachable(const Environment &env, std::pair<float, float> start) const {
+    const std::vector<Box> &boxes = *env.get_objects();
+    const Goal &goal = *env.get_goal();
+    const float c = params.cell;
+    const int nx = static_cast<int>(params.width / c);
+    const int ny = static_cast<int>(params.height / c);
+    auto center = [&](int i, int j) { return std::pair<float, float>{(i + 0.5f) * c, (j + 0.5f) * c}; };
+
+    // 0 free, 1 blocked, 2 visited. A cell is blocked if its centre lies inside a
+    // box inflated by half a cell; each box marks only the cells it covers.
+    std::vector<uint8_t> state(static_cast<size_t>(nx) * ny, 0);
+    for (const Box &b : boxes) {
+        auto [bx, by] = b.get_coords();
+        auto [w, h] = b.get_w_h();
+        float hw = w / 2 + c / 2, hh = h / 2 + c / 2;
+        // centre (i + 0.5) * c strictly inside (bx - hw, bx + hw)
+        int i0 = std::max(0, static_cast<int>(std::floor((bx - hw) / c - 0.5f)));
+        int i1 = std::min(nx - 1, static_cast<int>(std::ceil((bx + hw) / c - 0.5f)));
+        int j0 = std::max(0, static_cast<int>(std::floor((by - hh) / c - 0.5f)));
+        int j1 = std::min(ny - 1, static_cast<int>(std::ceil((by + hh) / c - 0.5f)));
+        for (int j = j0; j <= j1; ++j) {
+            for (int i = i0; i <= i1; ++i) {
+                auto [x, y] = center(i, j);
+                if (inside(b, x, y, c / 2)) state[j * nx + i] = 1;
+            }
+        }
+    }
+
+    auto [ax, ay] = start;
+    int si = std::clamp(static_cast<int>(ax / c), 0, nx - 1);
+    int sj = std::clamp(static_cast<int>(ay / c), 0, ny - 1);
+    if (state[sj * nx + si] == 1) return false;
+
+    std::queue<std::pair<int, int>> q;
+    q.push({si, sj});
+    state[sj * nx + si] = 2;
+    const int di[] = {1, -1, 0, 0};
+    const int dj[] = {0, 0, 1, -1};
+    while (!q.empty()) {
+        auto [i, j] = q.front();
+        q.pop();
+        auto [x, y] = center(i, j);
+        if (goal.check_colision(x, y)) return true;
+        for (int k = 0; k < 4; ++k) {
+            int ni = i + di[k], nj = j + dj[k];
+            if (ni < 0 || nj < 0 || ni >= nx || nj >= ny || state[nj * nx + ni] != 0) continue;
+            state[nj * nx + ni] = 2;
+            q.push({ni, nj});
+        }
+    }
+    return false;
+}
+
+Environment MapGenerator::generate(uint64_t seed) const {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<float> px(spawn_lo(params.width), spawn_hi(params.width));
+    std::uniform_real_distribution<float> py(spawn_lo(params.height), spawn_hi(params.height));
+    std::uniform_real_distribution<float> side(params.min_size, params.max_size);
+    const float target_area = params.density * params.width * params.height;
+
+    // Every start/goal draw counts as an attempt, whether it is rejected for
+    // being too close or for producing an unreachable map.
+    for (int attempt = 0; attempt < params.max_attempts; ++attempt) {
+        Agent agent(px(rng), py(rng));
+        auto [ax, ay] = agent.get_coords();
+        float gx = px(rng), gy = py(rng);
+        if (std::hypot(gx - ax, gy - ay) < params.min_goal_distance) continue;
+        Goal goal(gx, gy, params.goal_size, params.goal_size);
+
+        std::vector<Box> boxes;
+        float area = 0.0f;
+        for (int tries = 0; area < target_area && tries < 100000; ++tries) {
+            Box b(std::uniform_real_distribution<float>(0.0f, params.width)(rng),
+                  std::uniform_real_distribution<float>(0.0f, params.height)(rng),
+                  side(rng), side(rng));
+            if (inside(b, ax, ay, params.clearance) || overlaps(b, goal, params.clearance)) continue;
+            auto [w, h] = b.get_w_h();
+            area += w * h;
+            boxes.push_back(b);
+        }
+
+        Environment env(std::move(boxes), goal, agent, 0.0f, 0.0f, params.width, params.height);
+        if (reachable(env, {ax, ay})) {
+            return env;
+        }
+    }
+    throw std::runtime_error("no reachable map for seed " + std::to_string(seed));
+}
+
+}
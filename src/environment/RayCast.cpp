@@ -0,0 +1,182 @@
+#include "RayCast.hpp"
+#include "Env.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace project::env{
+
+namespace {
+
+float nearest_scalar(const BoxBounds &b, size_t from, const Slab &sx, const Slab &sy) {
+    float best = INFINITY;
+    for (size_t i = from; i < b.size(); i++) {
+        best = std::min(best, intersect_box(b, i, sx, sy));
+    }
+    return best;
+}
+
+#if defined(__AVX2__)
+
+constexpr size_t LANES = 8;
+
+struct VecSlab {
+    __m256 o, inv, inside_lo, inside_hi;
+    bool degenerate;
+
+    explicit VecSlab(const Slab &s)
+        : o(_mm256_set1_ps(s.o)), inv(_mm256_set1_ps(s.inv)),
+          inside_lo(_mm256_set1_ps(-INFINITY)), inside_hi(_mm256_set1_ps(INFINITY)),
+          degenerate(s.degenerate) {}
+
+    void range(const float *lo_b, const float *hi_b, __m256 &lo, __m256 &hi) const {
+        __m256 b0 = _mm256_loadu_ps(lo_b);
+        __m256 b1 = _mm256_loadu_ps(hi_b);
+        if (degenerate) {
+            __m256 inside = _mm256_and_ps(_mm256_cmp_ps(o, b0, _CMP_GT_OQ), _mm256_cmp_ps(o, b1, _CMP_LT_OQ));
+            lo = _mm256_blendv_ps(inside_hi, inside_lo, inside);
+            hi = _mm256_blendv_ps(inside_lo, inside_hi, inside);
+            return;
+        }
+        __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(b0, o), inv);
+        __m256 t2 = _mm256_mul_ps(_mm256_sub_ps(b1, o), inv);
+        lo = _mm256_min_ps(t1, t2);
+        hi = _mm256_max_ps(t1, t2);
+    }
+};
+
+float nearest(const BoxBounds &b, const Slab &sx, const Slab &sy) {
+    const VecSlab vx(sx), vy(sy);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 inf = _mm256_set1_ps(INFINITY);
+    __m256 best = inf;
+
+    size_t i = 0;
+    for (; i + LANES <= b.size(); i += LANES) {
+        __m256 lo_x, hi_x, lo_y, hi_y;
+        vx.range(&b.min_x[i], &b.max_x[i], lo_x, hi_x);
+        vy.range(&b.min_y[i], &b.max_y[i], lo_y, hi_y);
+        __m256 t_min = _mm256_max_ps(lo_x, lo_y);
+        __m256 t_max = _mm256_min_ps(hi_x, hi_y);
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(t_max, t_min, _CMP_GE_OQ), _mm256_cmp_ps(t_max, zero, _CMP_GE_OQ));
+        __m256 t = _mm256_blendv_ps(t_max, t_min, _mm256_cmp_ps(t_min, zero, _CMP_GE_OQ));
+        best = _mm256_min_ps(best, _mm256_blendv_ps(inf, t, hit));
+    }
+
+    __m128 m = _mm_min_ps(_mm256_castps256_ps128(best), _mm256_extractf128_ps(best, 1));
+    m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+    return std::min(_mm_cvtss_f32(m), nearest_scalar(b, i, sx, sy));
+}
+
+#elif defined(__SSE2__)
+
+constexpr size_t LANES = 4;
+
+inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+struct VecSlab {
+    __m128 o, inv, inside_lo, inside_hi;
+    bool degenerate;
+
+    explicit VecSlab(const Slab &s)
+        : o(_mm_set1_ps(s.o)), inv(_mm_set1_ps(s.inv)),
+          inside_lo(_mm_set1_ps(-INFINITY)), inside_hi(_mm_set1_ps(INFINITY)),
+          degenerate(s.degenerate) {}
+
+    void range(const float *lo_b, const float *hi_b, __m128 &lo, __m128 &hi) const {
+        __m128 b0 = _mm_loadu_ps(lo_b);
+        __m128 b1 = _mm_loadu_ps(hi_b);
+        if (degenerate) {
+            __m128 inside = _mm_and_ps(_mm_cmpgt_ps(o, b0), _mm_cmplt_ps(o, b1));
+            lo = select(inside, inside_lo, inside_hi);
+            hi = select(inside, inside_hi, inside_lo);
+            return;
+        }
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(b0, o), inv);
+        __m128 t2 = _mm_mul_ps(_mm_sub_ps(b1, o), inv);
+        lo = _mm_min_ps(t1, t2);
+        hi = _mm_max_ps(t1, t2);
+    }
+};
+
+float nearest(const BoxBounds &b, const Slab &sx, const Slab &sy) {
+    const VecSlab vx(sx), vy(sy);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 inf = _mm_set1_ps(INFINITY);
+    __m128 best = inf;
+
+    size_t i = 0;
+    for (; i + LANES <= b.size(); i += LANES) {
+        __m128 lo_x, hi_x, lo_y, hi_y;
+        vx.range(&b.min_x[i], &b.max_x[i], lo_x, hi_x);
+        vy.range(&b.min_y[i], &b.max_y[i], lo_y, hi_y);
+        __m128 t_min = _mm_max_ps(lo_x, lo_y);
+        __m128 t_max = _mm_min_ps(hi_x, hi_y);
+        __m128 hit = _mm_and_ps(_mm_cmpge_ps(t_max, t_min), _mm_cmpge_ps(t_max, zero));
+        __m128 t = select(_mm_cmpge_ps(t_min, zero), t_min, t_max);
+        best = _mm_min_ps(best, select(hit, t, inf));
+    }
+
+    __m128 m = _mm_min_ps(best, _mm_movehl_ps(best, best));
+    m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+    return std::min(_mm_cvtss_f32(m), nearest_scalar(b, i, sx, sy));
+}
+
+#else
+
+float nearest(const BoxBounds &b, const Slab &sx, const Slab &sy) {
+    return nearest_scalar(b, 0, sx, sy);
+}
+
+#endif
+
+}
+
+BoxBounds::BoxBounds(const std::vector<Box> &boxes) {
+    min_x.reserve(boxes.size());
+    max_x.reserve(boxes.size());
+    min_y.reserve(boxes.size());
+    max_y.reserve(boxes.size());
+    for (const Box &b : boxes) {
+        push_back(b);
+    }
+}
+
+void BoxBounds::push_back(const Box &box) {
+    std::pair<float, float> c = box.get_coords();
+    std::pair<float, float> w_h = box.get_w_h();
+    min_x.push_back(c.first - w_h.first / 2);
+    max_x.push_back(c.first + w_h.first / 2);
+    min_y.push_back(c.second - w_h.second / 2);
+    max_y.push_back(c.second + w_h.second / 2);
+}
+
+size_t BoxBounds::size() const {
+    return min_x.size();
+}
+
+float intersect_boxes(const BoxBounds &bounds, float o_x, float o_y, std::pair<float, float> dir) {
+    float t = nearest(bounds, Slab(o_x, dir.first), Slab(o_y, dir.second));
+    return t == INFINITY ? -1.0f : t;
+}
+
+float intersect_boxes_scalar(const BoxBounds &bounds, float o_x, float o_y, std::pair<float, float> dir) {
+    float t = nearest_scalar(bounds, 0, Slab(o_x, dir.first), Slab(o_y, dir.second));
+    return t == INFINITY ? -1.0f : t;
+}
+
+void cast_rays(const BoxBounds &bounds, float o_x, float o_y, const RayDirs &dirs, RayDists &res) {
+    for (size_t i = 0; i < dirs.size(); i++) {
+        res[i] = nearest(bounds, Slab(o_x, dirs[i].first), Slab(o_y, dirs[i].second));
+    }
+}
+
+}
@@ -1,4 +1,5 @@
 #include <SFML/Graphics.hpp>
+#include <chrono>
 #include <vector>
 #include "Types.hpp"
 #include "Consts.hpp"
@@ -64,8 +65,12 @@ DynamicRectangles::DynamicRectangles(project::env::Environment &env, bool addInt
 
 
 void DynamicRectangles::updateAgent(project::env::Agent* agent) {
-    float n_x = agent->get_coords().first;
-    float n_y = agent->get_coords().second;
+    updateAgent(agent->get_coords());
+}
+
+void DynamicRectangles::updateAgent(std::pair<float, float> xy) {
+    float n_x = xy.first;
+    float n_y = xy.second;
 
     agentRects_[0][0].position.x = n_x - agentR;
     agentRects_[0][0].position.y = n_y + agentR;
@@ -78,9 +83,13 @@ void DynamicRectangles::updateAgent(project::env::Agent* agent) {
 }
 
 void DynamicRectangles::updateInters(project::common::State* state) {
+    updateInters(state->obs_intersect);
+}
+
+void DynamicRectangles::updateInters(const std::array<std::pair<float, float>, common::SIZE_OF_ARRAY_OF_OBSERVATIONS>& inters) {
     if (withInters) {
-        for (int i = 0; i < state->obs_intersect.size(); i++) {
-            std::pair<float, float> p = state->obs_intersect[i];
+        for (int i = 0; i < inters.size(); i++) {
+            std::pair<float, float> p = inters[i];
             float n_x = p.first;
             float n_y = p.second;
 
@@ -110,4 +119,48 @@ void DynamicRectangles::draw(sf::RenderTarget& target) const {
     }
 }
 
+RenderThread::RenderThread(const env::Environment& env, float width, float height)
+    : env_(env), width_(width), height_(height), thread_([this] { loop(); }) {}
+
+RenderThread::~RenderThread() {
+    stop_ = true;
+    thread_.join();
+}
+
+bool RenderThread::submit(const Snapshot& snapshot) {
+    return open_ && queue_.try_push(snapshot);
+}
+
+bool RenderThread::is_open() const {
+    return open_;
+}
+
+void RenderThread::loop() {
+    sf::RenderWindow window(sf::VideoMode(width_, height_), "RL-path-finding");
+    window.setSize(sf::Vector2u(1000, 1000));
+    DynamicRectangles manager(env_, true);
+    Snapshot snapshot;
+
+    while (!stop_ && window.isOpen()) {
+        sf::Event event;
+        while (window.pollEvent(event)) {
+            if (event.type == sf::Event::Closed)
+                window.close();
+        }
+
+        if (!queue_.try_pop(snapshot)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        manager.updateAgent(snapshot.agent);
+        manager.updateInters(snapshot.inters);
+
+        window.clear();
+        manager.draw(window);
+        window.display();
+    }
+    open_ = false;
+}
+
 }
@@ -0,0 +1,138 @@
+#include "SpatialGrid.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace project::env{
+
+namespace {
+
+// Below this many boxes a linear SIMD scan is cheaper than walking cells.
+constexpr size_t MIN_BOXES_FOR_TRAVERSAL = 32;
+constexpr int MAX_CELLS_PER_SIDE = 512;
+
+}
+
+UniformGrid::UniformGrid(BoxBounds bounds) : bounds_(std::move(bounds)) {
+    size_t n = bounds_.size();
+    if (n == 0) {
+        return;
+    }
+    x0 = *std::min_element(bounds_.min_x.begin(), bounds_.min_x.end());
+    x1 = *std::max_element(bounds_.max_x.begin(), bounds_.max_x.end());
+    y0 = *std::min_element(bounds_.min_y.begin(), bounds_.min_y.end());
+    y1 = *std::max_element(bounds_.max_y.begin(), bounds_.max_y.end());
+
+    // About two cells per box along each side keeps most cells to a handful of entries.
+    int side = std::clamp(static_cast<int>(std::ceil(2 * std::sqrt(static_cast<float>(n)))), 1, MAX_CELLS_PER_SIDE);
+    cell = std::max(x1 - x0, y1 - y0) / side;
+    if (cell <= 0) {
+        cell = 1;
+    }
+    nx = std::max(1, static_cast<int>(std::ceil((x1 - x0) / cell)));
+    ny = std::max(1, static_cast<int>(std::ceil((y1 - y0) / cell)));
+
+    std::vector<uint32_t> count(static_cast<size_t>(nx) * ny + 1, 0);
+    auto for_cells = [&](size_t i, auto &&fn) {
+        for (int cy = cell_y(bounds_.min_y[i]); cy <= cell_y(bounds_.max_y[i]); cy++) {
+            for (int cx = cell_x(bounds_.min_x[i]); cx <= cell_x(bounds_.max_x[i]); cx++) {
+                fn(static_cast<size_t>(cy) * nx + cx);
+            }
+        }
+    };
+    for (size_t i = 0; i < n; i++) {
+        for_cells(i, [&](size_t c) { count[c + 1]++; });
+    }
+    for (size_t c = 1; c < count.size(); c++) {
+        count[c] += count[c - 1];
+    }
+    cell_start = count;
+    items.resize(cell_start.back());
+    for (size_t i = 0; i < n; i++) {
+        for_cells(i, [&](size_t c) { items[count[c]++] = static_cast<uint32_t>(i); });
+    }
+}
+
+int UniformGrid::cell_x(float x) const {
+    return std::clamp(static_cast<int>(std::floor((x - x0) / cell)), 0, nx - 1);
+}
+
+int UniformGrid::cell_y(float y) const {
+    return std::clamp(static_cast<int>(std::floor((y - y0) / cell)), 0, ny - 1);
+}
+
+const BoxBounds& UniformGrid::bounds() const {
+    return bounds_;
+}
+
+float UniformGrid::raycast(float o_x, float o_y, std::pair<float, float> dir) const {
+    if (bounds_.size() < MIN_BOXES_FOR_TRAVERSAL) {
+        return intersect_boxes(bounds_, o_x, o_y, dir);
+    }
+
+    Slab sx(o_x, dir.first), sy(o_y, dir.second);
+    float lo_x, hi_x, lo_y, hi_y;
+    sx.range(x0, x1, lo_x, hi_x);
+    sy.range(y0, y1, lo_y, hi_y);
+    float t = std::max(0.0f, std::max(lo_x, lo_y));
+    if (std::min(hi_x, hi_y) < t) {
+        return -1;
+    }
+
+    int cx = cell_x(o_x + dir.first * t);
+    int cy = cell_y(o_y + dir.second * t);
+    int step_x = sx.degenerate ? 0 : (dir.first > 0 ? 1 : -1);
+    int step_y = sy.degenerate ? 0 : (dir.second > 0 ? 1 : -1);
+    float next_x = sx.degenerate ? INFINITY : (x0 + (cx + (step_x > 0)) * cell - o_x) * sx.inv;
+    float next_y = sy.degenerate ? INFINITY : (y0 + (cy + (step_y > 0)) * cell - o_y) * sy.inv;
+    float delta_x = sx.degenerate ? INFINITY : cell * std::abs(sx.inv);
+    float delta_y = sy.degenerate ? INFINITY : cell * std::abs(sy.inv);
+
+    float best = INFINITY;
+    while (true) {
+        size_t c = static_cast<size_t>(cy) * nx + cx;
+        for (uint32_t k = cell_start[c]; k < cell_start[c + 1]; k++) {
+            best = std::min(best, intersect_box(bounds_, items[k], sx, sy));
+        }
+        if (best <= std::min(next_x, next_y)) {
+            break;
+        }
+        if (next_x < next_y) {
+            cx += step_x;
+            next_x += delta_x;
+        } else {
+            cy += step_y;
+            next_y += delta_y;
+        }
+        if (cx < 0 || cx >= nx || cy < 0 || cy >= ny) {
+            break;
+        }
+    }
+    return best == INFINITY ? -1.0f : best;
+}
+
+void UniformGrid::cast_rays(float o_x, float o_y, const RayDirs &dirs, RayDists &res) const {
+    if (bounds_.size() < MIN_BOXES_FOR_TRAVERSAL) {
+        env::cast_rays(bounds_, o_x, o_y, dirs, res);
+        return;
+    }
+    for (size_t i = 0; i < dirs.size(); i++) {
+        float t = raycast(o_x, o_y, dirs[i]);
+        res[i] = t < 0 ? INFINITY : t;
+    }
+}
+
+bool UniformGrid::check_colision(float o_x, float o_y) const {
+    if (bounds_.size() == 0 || o_x <= x0 || o_x >= x1 || o_y <= y0 || o_y >= y1) {
+        return false;
+    }
+    size_t c = static_cast<size_t>(cell_y(o_y)) * nx + cell_x(o_x);
+    for (uint32_t k = cell_start[c]; k < cell_start[c + 1]; k++) {
+        uint32_t i = items[k];
+        if (o_x > bounds_.min_x[i] && o_x < bounds_.max_x[i] && o_y > bounds_.min_y[i] && o_y < bounds_.max_y[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
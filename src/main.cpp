@@ -4,135 +4,305 @@
 #include <numeric>
 #include <filesystem>
 #include <thread>
+#include <memory>
+#include <optional>
+#include <cstring>
 #include "Renderer.hpp"
 
 #include "ml/RL.hpp"
+#include "ml/VecEnv.hpp"
+#include "ml/AsyncTrainer.hpp"
+#include "ml/NativeActor.hpp"
+#include "ml/QuantizedActor.hpp"
+#include "ml/Checkpoint.hpp"
+#include "ml/MapEval.hpp"
+#include "Telemetry.hpp"
+#include "Affinity.hpp"
 #include "environment/Env.hpp"
-#include "../config/Config.h"
+#include "../config/Settings.h"
 
 using namespace project::common;
 using namespace rl;
 
 int main(int argc, char* argv[]) {
     bool eval_mode = false;
+    int num_envs = 1;
+    int num_threads = 1;
+    bool headless = false;
+    int render_every = 1;
+    bool async_mode = false;
+    int num_collectors = 2;
+    bool prioritized = false;
+    bool use_native = false;
+    bool use_quantized = false;
+    bool export_only = false;
+    std::string replay_file;
+    size_t replay_capacity = 300000;
+    bool offline = false;
+    std::string checkpoint_path;
+    int checkpoint_every = 0;
+    std::string telemetry_csv, telemetry_json, trace_path;
+    std::string config_path;
+    std::vector<std::string> overrides;
+    int torch_threads = 0;
+    int interop_threads = 0;
+    bool pin_threads = false;
+    bool script_target = false;
+    size_t eval_maps = 0;
+    uint64_t map_seed = 0;
+    float map_density = project::env::MapParams{}.density;
 
-    if (argc > 1 && std::string(argv[1]) == "--eval") {
-        eval_mode = true;
-        std::cout << "Running in EVALUATION mode.\n";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--eval") {
+            eval_mode = true;
+        } else if (arg == "--envs" && i + 1 < argc) {
+            num_envs = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            num_threads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--render-every" && i + 1 < argc) {
+            render_every = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--async") {
+            async_mode = true;
+        } else if (arg == "--collectors" && i + 1 < argc) {
+            num_collectors = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--per") {
+            prioritized = true;
+        } else if (arg == "--native") {
+            use_native = true;
+        } else if (arg == "--quantize") {
+            use_quantized = true;
+        } else if (arg == "--export-actor") {
+            export_only = true;
+        } else if (arg == "--replay-file" && i + 1 < argc) {
+            replay_file = argv[++i];
+        } else if (arg == "--replay-capacity" && i + 1 < argc) {
+            replay_capacity = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else if (arg == "--offline") {
+            offline = true;
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoint_path = argv[++i];
+        } else if (arg == "--checkpoint-every" && i + 1 < argc) {
+            checkpoint_every = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--telemetry-csv" && i + 1 < argc) {
+            telemetry_csv = argv[++i];
+        } else if (arg == "--telemetry-json" && i + 1 < argc) {
+            telemetry_json = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg == "--config" && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (arg == "--set" && i + 1 < argc) {
+            overrides.push_back(argv[++i]);
+        } else if (arg == "--torch-threads" && i + 1 < argc) {
+            torch_threads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--interop-threads" && i + 1 < argc) {
+            interop_threads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--pin") {
+            pin_threads = true;
+        } else if (arg == "--script-target") {
+            script_target = true;
+        } else if (arg == "--eval-maps" && i + 1 < argc) {
+            eval_maps = std::stoull(argv[++i]);
+        } else if (arg == "--map-seed" && i + 1 < argc) {
+            map_seed = std::stoull(argv[++i]);
+        } else if (arg == "--map-density" && i + 1 < argc) {
+            map_density = std::stof(argv[++i]);
+        }
     }
 
-    const float MAX_DISTANCE = std::sqrt(project::config::WORLD_WIDTH * project::config::WORLD_WIDTH
-                                        + project::config::WORLD_HEIGHT * project::config::WORLD_HEIGHT);
+    project::config::Settings settings = project::config::Settings::defaults();
+    try {
+        if (!config_path.empty()) {
+            settings.load_ini(config_path);
+        }
+        for (const auto& o : overrides) {
+            settings.set(o);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Config error: " << e.what() << "\n";
+        return 1;
+    }
+    if (async_mode && !eval_mode && !checkpoint_path.empty()) {
+        std::cerr << "--checkpoint is not supported with --async: the async learner "
+                     "and its sharded replay buffer are not checkpointed.\n";
+        return 1;
+    }
+    if (checkpoint_every == 0) {
+        checkpoint_every = settings.log_interval;
+    }
 
-    project::env::Environment env = project::config::env;
+    if (eval_mode) {
+        std::cout << "Running in EVALUATION mode.\n";
+    } else if (use_native || use_quantized) {
+        std::cerr << "--native/--quantize ignored: they only apply with --eval.\n";
+    }
+#ifdef RLPF_TELEMETRY
+    Telemetry::instance().set_tracing(!trace_path.empty());
+#else
+    if (!telemetry_csv.empty() || !telemetry_json.empty() || !trace_path.empty()) {
+        std::cerr << "Telemetry options ignored: built without RLPF_TELEMETRY.\n";
+    }
+#endif
 
-    sf::RenderWindow window(sf::VideoMode(project::config::WORLD_WIDTH, project::config::WORLD_HEIGHT), "RL-path-finding");
-    window.setSize(sf::Vector2u(1000, 1000));
-    project::ren::DynamicRectangles manager(env, true);
+    // Threading policy, applied before libtorch starts any pool. With --pin the
+    // env workers / collectors get one CPU each and this thread (the learner) is
+    // bound to what is left of the first NUMA node; libtorch's intra-op threads
+    // inherit that mask, and the replay storage allocated below is first touched
+    // here, so it stays local to the learner that samples it.
+    if (interop_threads > 0) {
+        torch::set_num_interop_threads(interop_threads);
+    }
+    CpuPlan cpu_plan;
+    if (pin_threads) {
+        size_t workers = async_mode ? num_collectors : (num_envs > 1 ? num_threads - 1 : 0);
+        cpu_plan = CpuPlan::make(workers);
+        pin_current_thread(cpu_plan.learner);
+    }
+    if (torch_threads > 0) {
+        torch::set_num_threads(torch_threads);
+    } else if (pin_threads) {
+        torch::set_num_threads(static_cast<int>(cpu_plan.learner.size()));
+    }
 
-    TD3Agent agent(project::config::ACTOR_LR, project::config::CRITIC_LR,
-                   project::config::GAMMA, project::config::TAU, MAX_DISTANCE);
+    project::env::Environment env = settings.make_environment();
+    const float MAX_DISTANCE = env.get_max_distance();
+
+    TD3Agent agent(settings.actor_lr, settings.critic_lr,
+                   settings.gamma, settings.tau, MAX_DISTANCE);
+    agent.set_scripted_target(script_target);
 
     if (std::filesystem::exists("actor.pt") && std::filesystem::exists("critic1.pt") && std::filesystem::exists("critic2.pt")) {
         agent.load_model("actor.pt", "critic1.pt", "critic2.pt");
         std::cout << "Model loaded from disk.\n";
     }
 
-    if (eval_mode) {
-        agent.set_eval_mode(true);
+    if (export_only) {
+        agent.export_actor("actor.bin");
+        std::cout << "Actor exported to actor.bin.\n";
+        return 0;
     }
 
-    ReplayBuffer buffer(300000);
-    std::vector<float> episode_rewards;
-    int success_count = 0;
-    auto start_time = std::chrono::steady_clock::now();
-
-    for (int ep = 0; ep < project::config::EPISODES; ++ep) {
-        State s = env.reset();
-        manager = project::ren::DynamicRectangles(env, true);
-        auto state = agent.preprocess_state(s);
-        float ep_reward = 0.0f;
-        bool episode_success = false;
-
-        float noise_std = eval_mode ? 0.0f : std::max(0.05f, 0.5f * (1.0f - ep / 8000.0f));
-
-        for (int t = 0; t < project::config::MAX_STEPS; ++t) {
-            auto [action_tensor, _] = agent.select_action(state, noise_std);
-            auto action_data = action_tensor.squeeze().data_ptr<float>();
-            Action action{{action_data[0], action_data[1]}, 1.0f};
-
-            State s2 = env.do_action(action);
-            if (window.isOpen()) {
-                sf::Event event;
-                while (window.pollEvent(event)) {
-                    if (event.type == sf::Event::Closed)
-                        window.close();
-                }
+    if (eval_maps > 0) {
+        NativeActor actor = std::filesystem::exists("actor.bin") ? NativeActor::load("actor.bin") : agent.native_actor();
+        MapEvalConfig config;
+        // MapParams defaults are tuned for a 100x100 world; scale the lengths to
+        // the configured one so small worlds still have room for a goal.
+        float scale = std::min(settings.world_width, settings.world_height) / 100.0f;
+        config.map.width = settings.world_width;
+        config.map.height = settings.world_height;
+        config.map.density = map_density;
+        config.map.min_size *= scale;
+        config.map.max_size *= scale;
+        config.map.goal_size = std::min(settings.goal.w, settings.goal.h);
+        config.map.min_goal_distance *= scale;
+        config.map.clearance *= scale;
+        config.seed = map_seed;
+        config.maps = eval_maps;
+        config.max_steps = settings.max_steps;
+        config.threads = num_threads;
+        MapEvalReport report;
+        try {
+            report = evaluate_maps(actor, config);
+        } catch (const std::exception& e) {
+            std::cerr << "Map evaluation error: " << e.what() << "\n";
+            return 1;
+        }
+        std::cout << "Maps: " << report.maps
+                  << " | Unreachable: " << report.failed_maps
+                  << " | Success: " << report.success_rate() * 100.0 << "%"
+                  << " | Collisions: " << report.collisions
+                  << " | Mean path: " << report.mean_path_length()
+                  << " (x" << report.mean_path_ratio() << " straight line)"
+                  << " | Steps/sec: " << report.steps_per_sec()
+                  << " | Time: " << report.seconds << "s" << std::endl;
+        return 0;
+    }
 
-                manager.updateAgent(env.get_agent());
-                manager.updateInters(&s2);
+    if (eval_mode) {
+        agent.set_eval_mode(true);
+    }
 
-                window.clear();
-                manager.draw(window);
-                window.display();
-                if (eval_mode) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                }
-            }
-            auto next_state = agent.preprocess_state(s2);
+    std::optional<NativeActor> native;
+    if (eval_mode && use_native) {
+        native = NativeActor::load("actor.bin");
+        std::cout << "Using native actor from actor.bin.\n";
+    }
 
-            float reward = -0.001f;
-            bool done = false;
+    ReplayBuffer buffer = replay_file.empty()
+        ? ReplayBuffer(replay_capacity, prioritized)
+        : ReplayBuffer(replay_file, replay_capacity, prioritized);
+    if (!replay_file.empty()) {
+        std::cout << "Replay buffer " << replay_file << " holds " << buffer.size() << " transitions.\n";
+    }
 
-            switch (s2.env_type) {
-                case EnvState::TERMINAL:
-                    reward = 500.0f;
-                    done = true;
-                    episode_success = true;
-                    break;
-                case EnvState::COLLISION:
-                    reward = -100.0f;
-                    done = true;
-                    break;
-                case EnvState::TIMEOUT:
-                    reward = -5.0f;
-                    done = true;
-                    break;
-                default:
-                    float progress = (s.distance_to_goal - s2.distance_to_goal) / MAX_DISTANCE;
-                    reward += 30.0f * progress;
-                    if (progress > 0.0f) reward += MAX_DISTANCE *
-                        (1.0f / s2.distance_to_goal - 1.0f / s.distance_to_goal);
-            }
+    int start_episode = 0;
+    // Unspent update credit, see train() below; part of the checkpoint.
+    double update_credit = 0.0;
+    std::unique_ptr<CheckpointWriter> checkpointer;
+    if (!checkpoint_path.empty() && !eval_mode) {
+        if (std::filesystem::exists(checkpoint_path)) {
+            TrainingProgress progress = load_checkpoint(checkpoint_path, agent, buffer);
+            start_episode = static_cast<int>(progress.episode);
+            update_credit = progress.update_credit;
+            std::cout << "Resuming from " << checkpoint_path << " at episode " << start_episode << ".\n";
+        }
+        checkpointer = std::make_unique<CheckpointWriter>(checkpoint_path);
+    }
+    // Called once episode ep has finished; the checkpoint resumes at ep + 1.
+    auto maybe_checkpoint = [&](int ep) {
+        if (checkpointer && (ep + 1) % checkpoint_every == 0) {
+            checkpointer->submit(serialize_checkpoint(agent, buffer, {ep + 1, update_credit}));
+        }
+    };
 
-            if (!eval_mode) {
-                buffer.push({
-                    state,
-                    action_tensor,
-                    torch::tensor({reward}, torch::kFloat32),
-                    next_state,
-                    torch::tensor({done ? 1.0f : 0.0f}, torch::kFloat32)
-                });
-
-                if (buffer.size() > project::config::TRAIN_START_SIZE && t % project::config::TRAIN_INTERVAL == 0) {
-                    agent.update(buffer, project::config::BATCH_SIZE);
-                }
+    // Calibrate the int8 actor on the replay buffer's stored states (e.g. from
+    // --replay-file; reading does not modify the file). With an empty buffer, fall
+    // back to the states of one greedy fp32 rollout, which is deterministic, so a
+    // single episode covers it. The fp32 network stays around as the reference
+    // for the reported action error.
+    std::optional<QuantizedActor> quantized;
+    double quant_err_sum = 0.0, quant_err_max = 0.0;
+    int64_t quant_err_count = 0;
+    if (eval_mode && use_quantized) {
+        NativeActor fp32 = agent.native_actor();
+        torch::Tensor states;
+        if (buffer.size() > 0) {
+            states = buffer.states().contiguous();
+        } else {
+            project::env::Environment calib_env = env;
+            std::vector<float> rollout;
+            float obs[TOTAL_OBS_SIZE], act[ACT_SIZE];
+            calib_env.restart(obs);
+            for (int t = 0; t < settings.max_steps; ++t) {
+                rollout.insert(rollout.end(), obs, obs + TOTAL_OBS_SIZE);
+                fp32.forward(obs, act);
+                if (calib_env.step({{act[0], act[1]}, 1.0f}, obs).env_type != EnvState::NONE) break;
             }
-
-            state = next_state;
-            ep_reward += reward;
-            if (done) break;
+            states = torch::from_blob(rollout.data(), {static_cast<int64_t>(rollout.size() / TOTAL_OBS_SIZE), TOTAL_OBS_SIZE}).clone();
         }
+        quantized = QuantizedActor::calibrate(fp32, states.data_ptr<float>(), states.size(0));
+        native = fp32;
+        std::cout << "Quantized actor calibrated on " << states.size(0)
+                  << (buffer.size() > 0 ? " replay" : " rollout") << " states ("
+                  << quantized->weight_bytes() / 1024 << " KiB of weights).\n";
+    }
 
-        if (episode_success) success_count++;
-        episode_rewards.push_back(ep_reward);
+    std::vector<float> episode_rewards;
+    int success_count = 0;
+    int total_success = 0;
+    auto start_time = std::chrono::steady_clock::now();
 
-        if (ep % project::config::LOG_INTERVAL == 0 && ep > 0) {
+    auto log_progress = [&](int ep, float noise_std) {
+        if (ep % settings.log_interval == 0 && ep > 0
+            && episode_rewards.size() >= static_cast<size_t>(settings.log_interval)) {
             auto avg_reward = std::accumulate(
-                episode_rewards.end() - project::config::LOG_INTERVAL,
-                episode_rewards.end(), 0.0f) / project::config::LOG_INTERVAL;
+                episode_rewards.end() - settings.log_interval,
+                episode_rewards.end(), 0.0f) / settings.log_interval;
 
-            auto success_rate = success_count * 100.0f / project::config::LOG_INTERVAL;
+            auto success_rate = success_count * 100.0f / settings.log_interval;
             success_count = 0;
 
             auto current_time = std::chrono::steady_clock::now();
@@ -144,12 +314,203 @@ int main(int argc, char* argv[]) {
                       << " | Time: " << elapsed << "s"
                       << " | Noise: " << noise_std
                       << " | Buffer: " << buffer.size() << std::endl;
+#ifdef RLPF_TELEMETRY
+            auto report = Telemetry::instance().report();
+            std::cout << "  env steps/s: " << report.rate("env_steps")
+                      << " | updates/s: " << report.rate("updates") << "\n"
+                      << Telemetry::format(report);
+            if (!telemetry_csv.empty()) Telemetry::append_csv(telemetry_csv, report, ep);
+            if (!telemetry_json.empty()) Telemetry::append_json(telemetry_json, report, ep);
+#endif
+        }
+    };
+
+    // Updates are paid for out of a credit that grows by utd_ratio per collected
+    // transition and are run updates_per_sample at a time from one sampled batch.
+    auto train = [&](double new_samples) {
+        if (buffer.size() <= static_cast<size_t>(settings.train_start_size)) return;
+        update_credit += settings.update_ratio() * new_samples;
+        const int k = settings.updates_per_sample;
+        while (update_credit >= k) {
+            agent.update_batched(buffer, settings.batch_size, k);
+            update_credit -= k;
         }
+    };
+
+    if (offline && !eval_mode) {
+        // Train on previously collected data only: one "episode" is MAX_STEPS
+        // updates, so the schedule matches an online run of the same length.
+        if (buffer.size() < static_cast<size_t>(settings.batch_size)) {
+            std::cerr << "Offline training needs a replay file with at least "
+                      << settings.batch_size << " transitions.\n";
+            return 1;
+        }
+        for (int ep = start_episode; ep < settings.episodes; ++ep) {
+            buffer.anneal_beta(static_cast<double>(ep) / settings.episodes);
+            const int updates = static_cast<int>(settings.max_steps * settings.update_ratio());
+            for (int done = 0; done < updates; done += settings.updates_per_sample) {
+                agent.update_batched(buffer, settings.batch_size, std::min(settings.updates_per_sample, updates - done));
+            }
+            maybe_checkpoint(ep);
+            if (ep % settings.log_interval == 0 && ep > 0) {
+                auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+                    std::chrono::steady_clock::now() - start_time).count();
+                std::cout << "Offline epoch " << ep << " | Time: " << elapsed << "s"
+                          << " | Buffer: " << buffer.size() << std::endl;
+            }
+        }
+    } else if (async_mode && !eval_mode) {
+        AsyncConfig config;
+        config.collectors = num_collectors;
+        config.envs_per_collector = num_envs;
+        config.episodes = settings.episodes;
+        config.max_steps = settings.max_steps;
+        config.batch_size = settings.batch_size;
+        config.train_start_size = settings.train_start_size;
+        config.buffer_capacity = replay_capacity;
+        config.log_interval = settings.log_interval;
+        config.collector_cpus = cpu_plan.workers;
+        config.update_ratio = settings.update_ratio();
+        config.learner_threads = torch_threads > 0 ? torch_threads : static_cast<int>(cpu_plan.learner.size());
+        config.telemetry_csv = telemetry_csv;
+        config.telemetry_json = telemetry_json;
+        AsyncTrainer(agent, env, config, MAX_DISTANCE).run();
+    } else if (num_envs > 1) {
+        VecEnvironment venv(env, num_envs, settings.max_steps, MAX_DISTANCE, num_threads, cpu_plan.workers);
+        auto obs = venv.reset();
+        std::vector<float> ep_reward(num_envs, 0.0f);
+        int ep = start_episode;
+
+        while (ep < settings.episodes) {
+            buffer.anneal_beta(static_cast<double>(ep) / settings.episodes);
+            float noise_std = eval_mode ? 0.0f : std::max(0.05f, 0.5f * (1.0f - ep / 8000.0f));
+            auto [action_tensor, _] = agent.select_action(obs, noise_std);
+            const auto& step = venv.step(action_tensor);
+
+            if (!eval_mode) {
+                const float* s = obs.data_ptr<float>();
+                const float* a = action_tensor.data_ptr<float>();
+                const float* r = step.reward.data_ptr<float>();
+                const float* s2 = step.next_obs.data_ptr<float>();
+                const float* d = step.done.data_ptr<float>();
+                for (int i = 0; i < num_envs; ++i) {
+                    buffer.push(s + i * TOTAL_OBS_SIZE, a + i * ACT_SIZE, r[i], s2 + i * TOTAL_OBS_SIZE, d[i] > 0.5f);
+                }
+
+                train(num_envs);
+            }
+
+            const float* r = step.reward.data_ptr<float>();
+            for (int i = 0; i < num_envs && ep < settings.episodes; ++i) {
+                ep_reward[i] += r[i];
+                if (!step.finished[i]) continue;
+
+                if (step.env_type[i] == EnvState::TERMINAL) success_count++;
+                episode_rewards.push_back(ep_reward[i]);
+                ep_reward[i] = 0.0f;
+                log_progress(ep, noise_std);
+                maybe_checkpoint(ep);
+                ++ep;
+            }
+
+            obs = step.obs;
+        }
+    } else {
+        std::unique_ptr<project::ren::RenderThread> renderer;
+        if (!headless) {
+            renderer = std::make_unique<project::ren::RenderThread>(
+                env, settings.world_width, settings.world_height);
+        }
+
+        // The environment writes observations straight into these two rows; the
+        // tensors are views over them, so a step costs no allocation or copy.
+        float obs_rows[2][TOTAL_OBS_SIZE];
+        torch::Tensor obs_views[2] = {
+            torch::from_blob(obs_rows[0], {1, TOTAL_OBS_SIZE}),
+            torch::from_blob(obs_rows[1], {1, TOTAL_OBS_SIZE})
+        };
+
+        for (int ep = start_episode; ep < settings.episodes; ++ep) {
+            buffer.anneal_beta(static_cast<double>(ep) / settings.episodes);
+            int cur = 0;
+            CompactState s = env.restart(obs_rows[cur]);
+            bool render = renderer && renderer->is_open() && ep % render_every == 0;
+            float ep_reward = 0.0f;
+            bool episode_success = false;
+
+            float noise_std = eval_mode ? 0.0f : std::max(0.05f, 0.5f * (1.0f - ep / 8000.0f));
+
+            for (int t = 0; t < settings.max_steps; ++t) {
+                const float* state = obs_rows[cur];
+                float* next_state = obs_rows[cur ^ 1];
+                float action_data[ACT_SIZE];
+                if (quantized) {
+                    float reference[ACT_SIZE];
+                    quantized->forward(state, action_data);
+                    native->forward(state, reference);
+                    for (int k = 0; k < ACT_SIZE; ++k) {
+                        double err = std::abs(action_data[k] - reference[k]);
+                        quant_err_sum += err;
+                        quant_err_max = std::max(quant_err_max, err);
+                        quant_err_count++;
+                    }
+                } else if (native) {
+                    native->forward(state, action_data);
+                } else {
+                    auto action_tensor = agent.select_action(obs_views[cur], noise_std).first;
+                    std::memcpy(action_data, action_tensor.data_ptr<float>(), sizeof(action_data));
+                }
+                Action action{{action_data[0], action_data[1]}, 1.0f};
+
+                CompactState s2 = env.step(action, next_state);
+                if (render) {
+                    renderer->submit({env.get_agent()->get_coords(), env.intersections(s2.obs)});
+                    if (eval_mode) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    }
+                }
+                auto [reward, done] = compute_reward(s, s2, MAX_DISTANCE);
+                if (s2.env_type == EnvState::TERMINAL) {
+                    episode_success = true;
+                }
+
+                if (!eval_mode) {
+                    buffer.push(state, action_data, reward, next_state, done);
+
+                    train(1);
+                }
+
+                cur ^= 1;
+                ep_reward += reward;
+                if (done) break;
+            }
+
+            if (episode_success) {
+                success_count++;
+                total_success++;
+            }
+            episode_rewards.push_back(ep_reward);
+            log_progress(ep, noise_std);
+            maybe_checkpoint(ep);
+        }
+    }
+
+#ifdef RLPF_TELEMETRY
+    if (!trace_path.empty()) {
+        Telemetry::instance().write_trace(trace_path);
+    }
+#endif
+
+    if (quantized) {
+        std::cout << "Quantized actor | Mean action error: " << quant_err_sum / std::max<int64_t>(quant_err_count, 1)
+                  << " | Max action error: " << quant_err_max
+                  << " | Success: " << total_success * 100.0f / settings.episodes << "%" << std::endl;
     }
 
     if (!eval_mode) {
         std::cout << "Saving model...\n";
         agent.save_model("actor.pt", "critic1.pt", "critic2.pt");
+        agent.export_actor("actor.bin");
     }
 
     return 0;
@@ -0,0 +1,157 @@
+#include "ml/AsyncTrainer.hpp"
+#include "ml/VecEnv.hpp"
+#include "Affinity.hpp"
+#include "Telemetry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+
+namespace rl {
+
+AsyncTrainer::AsyncTrainer(TD3Agent& agent, const project::env::Environment& env, AsyncConfig config, float max_distance)
+    : agent_(agent), env_(env), config_(config), max_distance_(max_distance),
+      buffer_(config.buffer_capacity, config.collectors) {
+    publish_actor();
+}
+
+void AsyncTrainer::publish_actor() {
+    auto actor = std::make_shared<const NativeActor>(agent_.native_actor());
+    std::lock_guard<std::mutex> lock(published_mutex_);
+    published_ = std::move(actor);
+    published_version_.fetch_add(1, std::memory_order_release);
+}
+
+void AsyncTrainer::record_episode(float reward, bool success) {
+    int ep = episodes_.fetch_add(1);
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    episode_rewards_.push_back(reward);
+    if (success) success_count_++;
+
+    if (config_.log_interval > 0 && ep % config_.log_interval == 0 && ep > 0) {
+        auto avg_reward = std::accumulate(
+            episode_rewards_.end() - config_.log_interval,
+            episode_rewards_.end(), 0.0f) / config_.log_interval;
+        auto success_rate = success_count_ * 100.0f / config_.log_interval;
+        success_count_ = 0;
+
+        std::cout << "Episode " << ep
+                  << " | Avg Reward: " << avg_reward
+                  << " | Success: " << success_rate << "%"
+                  << " | Env steps: " << env_steps_.load()
+                  << " | Buffer: " << buffer_.size() << std::endl;
+#ifdef RLPF_TELEMETRY
+        using project::common::Telemetry;
+        auto report = Telemetry::instance().report();
+        std::cout << "  env steps/s: " << report.rate("env_steps")
+                  << " | updates/s: " << report.rate("updates") << "\n"
+                  << Telemetry::format(report);
+        if (!config_.telemetry_csv.empty()) Telemetry::append_csv(config_.telemetry_csv, report, ep);
+        if (!config_.telemetry_json.empty()) Telemetry::append_json(config_.telemetry_json, report, ep);
+#endif
+    }
+}
+
+void AsyncTrainer::collect(size_t id) {
+    if (!config_.collector_cpus.empty()) {
+        project::common::pin_current_thread({config_.collector_cpus[id % config_.collector_cpus.size()]});
+    }
+    std::unique_lock<std::mutex> lock(published_mutex_);
+    NativeActor actor = *published_;
+    uint64_t version = published_version_.load(std::memory_order_relaxed);
+    lock.unlock();
+    std::mt19937 rng(std::random_device{}());
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+
+    const size_t n = config_.envs_per_collector;
+    VecEnvironment venv(env_, n, config_.max_steps, max_distance_);
+    auto obs = venv.reset();
+    auto action = torch::empty({static_cast<int64_t>(n), ACT_SIZE});
+    std::vector<float> ep_reward(n, 0.0f);
+
+    while (!stop_.load(std::memory_order_relaxed)) {
+        if (published_version_.load(std::memory_order_acquire) != version) {
+            std::lock_guard<std::mutex> lock(published_mutex_);
+            actor = *published_;
+            version = published_version_.load(std::memory_order_relaxed);
+        }
+
+        int ep = episodes_.load(std::memory_order_relaxed);
+        float noise_std = std::max(0.05f, 0.5f * (1.0f - ep / 8000.0f));
+        const float* s = obs.data_ptr<float>();
+        float* a = action.data_ptr<float>();
+        // Same rule as add_exploration_noise, without going through libtorch.
+        for (size_t i = 0; i < n; ++i) {
+            actor.forward(s + i * TOTAL_OBS_SIZE, a + i * ACT_SIZE);
+            for (size_t k = 0; k < ACT_SIZE; ++k) {
+                float noise = std::clamp(gauss(rng) * noise_std, -0.5f, 0.5f);
+                a[i * ACT_SIZE + k] = std::clamp(a[i * ACT_SIZE + k] + noise, -1.0f, 1.0f);
+            }
+        }
+        const auto& step = venv.step(action);
+
+        const float* r = step.reward.data_ptr<float>();
+        const float* s2 = step.next_obs.data_ptr<float>();
+        const float* d = step.done.data_ptr<float>();
+        for (size_t i = 0; i < n; ++i) {
+            buffer_.push(id, s + i * TOTAL_OBS_SIZE, a + i * ACT_SIZE, r[i], s2 + i * TOTAL_OBS_SIZE, d[i] > 0.5f);
+            ep_reward[i] += r[i];
+            if (step.finished[i]) {
+                record_episode(ep_reward[i], step.env_type[i] == project::common::EnvState::TERMINAL);
+                ep_reward[i] = 0.0f;
+            }
+        }
+        env_steps_.fetch_add(static_cast<int64_t>(n), std::memory_order_relaxed);
+
+        if (episodes_.load(std::memory_order_relaxed) >= config_.episodes) {
+            stop_ = true;
+        }
+        obs = step.obs;
+    }
+}
+
+void AsyncTrainer::run() {
+    auto start_time = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> collectors;
+    for (size_t i = 0; i < config_.collectors; ++i) {
+        collectors.emplace_back([this, i] { collect(i); });
+    }
+    if (config_.learner_threads > 0) {
+        torch::set_num_threads(config_.learner_threads);
+    }
+
+    int64_t updates = 0;
+    int64_t train_start_steps = -1;
+    while (!stop_.load(std::memory_order_relaxed)) {
+        if (buffer_.size() < config_.train_start_size) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (config_.update_ratio > 0.0f) {
+            int64_t steps = env_steps_.load(std::memory_order_relaxed);
+            if (train_start_steps < 0) train_start_steps = steps;
+            if (updates >= config_.update_ratio * static_cast<double>(steps - train_start_steps)) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+        }
+        agent_.update(buffer_.sample(config_.batch_size));
+        if (++updates % config_.sync_interval == 0) {
+            publish_actor();
+        }
+    }
+
+    for (auto& c : collectors) {
+        c.join();
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "Async run: " << env_steps_.load() << " env steps, " << updates << " updates in "
+              << elapsed << "s (" << env_steps_.load() / elapsed << " steps/s, "
+              << updates / elapsed << " updates/s)" << std::endl;
+}
+
+}
@@ -0,0 +1,137 @@
+#include "ml/Checkpoint.hpp"
+#include <ATen/CPUGeneratorImpl.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace rl {
+
+namespace {
+
+torch::Tensor bytes_to_tensor(const std::string& bytes) {
+    auto t = torch::empty({static_cast<int64_t>(bytes.size())}, torch::kUInt8);
+    std::memcpy(t.data_ptr<uint8_t>(), bytes.data(), bytes.size());
+    return t;
+}
+
+std::string tensor_to_bytes(const torch::Tensor& t) {
+    auto c = t.contiguous();
+    return std::string(reinterpret_cast<const char*>(c.data_ptr<uint8_t>()), c.numel());
+}
+
+}
+
+std::string serialize_checkpoint(TD3Agent& agent, const ReplayBuffer& buffer, const TrainingProgress& progress) {
+    torch::serialize::OutputArchive archive;
+    archive.write("version", torch::tensor(CHECKPOINT_VERSION));
+    archive.write("episode", torch::tensor(progress.episode));
+    archive.write("update_credit", torch::tensor(progress.update_credit, torch::kFloat64));
+
+    torch::serialize::OutputArchive agent_archive;
+    agent.save_checkpoint(agent_archive);
+    archive.write("agent", agent_archive);
+
+    auto gen = at::detail::getDefaultCPUGenerator();
+    {
+        std::lock_guard<std::mutex> lock(gen.mutex());
+        archive.write("torch_rng", gen.get_state());
+    }
+    torch::serialize::OutputArchive replay_archive;
+    buffer.save_contents(replay_archive);
+    archive.write("replay", replay_archive);
+    archive.write("buffer_rng", bytes_to_tensor(buffer.rng_state()));
+    archive.write("priorities", buffer.priorities());
+    archive.write("max_priority", torch::tensor(buffer.max_priority()));
+
+    std::string bytes;
+    archive.save_to([&](const void* data, size_t size) {
+        bytes.append(static_cast<const char*>(data), size);
+        return size;
+    });
+    return bytes;
+}
+
+TrainingProgress load_checkpoint(const std::string& path, TD3Agent& agent, ReplayBuffer& buffer) {
+    torch::serialize::InputArchive archive;
+    archive.load_from(path);
+
+    torch::Tensor version;
+    archive.read("version", version);
+    if (version.item<int64_t>() != CHECKPOINT_VERSION) {
+        throw std::runtime_error("unsupported checkpoint version in " + path);
+    }
+
+    torch::serialize::InputArchive agent_archive;
+    archive.read("agent", agent_archive);
+    agent.load_checkpoint(agent_archive);
+
+    torch::serialize::InputArchive replay_archive;
+    archive.read("replay", replay_archive);
+    buffer.load_contents(replay_archive);
+
+    torch::Tensor torch_rng, buffer_rng, priorities, max_priority, episode, update_credit;
+    archive.read("torch_rng", torch_rng);
+    archive.read("buffer_rng", buffer_rng);
+    archive.read("priorities", priorities);
+    archive.read("max_priority", max_priority);
+    archive.read("episode", episode);
+    archive.read("update_credit", update_credit);
+
+    auto gen = at::detail::getDefaultCPUGenerator();
+    {
+        std::lock_guard<std::mutex> lock(gen.mutex());
+        gen.set_state(torch_rng);
+    }
+    buffer.set_rng_state(tensor_to_bytes(buffer_rng));
+    buffer.set_priorities(priorities, max_priority.item<float>());
+    return {episode.item<int64_t>(), update_credit.item<double>()};
+}
+
+CheckpointWriter::CheckpointWriter(std::string path)
+    : path_(std::move(path)), thread_([this] { run(); }) {}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void CheckpointWriter::submit(std::string bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = std::move(bytes);
+    }
+    cv_.notify_one();
+}
+
+void CheckpointWriter::run() {
+    const std::string tmp = path_ + ".tmp";
+    for (;;) {
+        std::string bytes;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || pending_; });
+            if (!pending_) return;
+            bytes = std::move(*pending_);
+            pending_.reset();
+        }
+
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        out.close();
+        std::error_code ec;
+        if (out) {
+            std::filesystem::rename(tmp, path_, ec);
+        }
+        if (!out || ec) {
+            std::cerr << "Failed to write checkpoint " << path_ << "\n";
+        }
+    }
+}
+
+}
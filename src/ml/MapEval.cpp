@@ -0,0 +1,88 @@
+#include "ml/MapEval.hpp"
+#include "ThreadPool.hpp"
+#include "Consts.hpp"
+#include "Types.hpp"
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <vector>
+
+namespace rl {
+
+namespace {
+
+struct MapResult {
+    bool generated = true;
+    bool success = false;
+    bool collision = false;
+    int steps = 0;
+    float path = 0.0f;
+    float straight = 0.0f;
+};
+
+MapResult run_map(const NativeActor& actor, const project::env::MapGenerator& generator, uint64_t seed, int max_steps) {
+    using project::common::EnvState;
+    project::env::Environment env = generator.generate(seed);
+    float obs[project::common::TOTAL_OBS_SIZE];
+    float act[2];
+
+    MapResult r;
+    project::common::CompactState s = env.restart(obs);
+    r.straight = s.distance_to_goal;
+    auto [x, y] = env.get_agent()->get_coords();
+    for (int t = 0; t < max_steps; ++t) {
+        actor.forward(obs, act);
+        s = env.step({{act[0], act[1]}, 1.0f}, obs);
+        auto [nx, ny] = env.get_agent()->get_coords();
+        r.path += std::hypot(nx - x, ny - y);
+        x = nx;
+        y = ny;
+        r.steps++;
+        if (s.env_type == EnvState::TERMINAL) {
+            r.success = true;
+            break;
+        }
+        if (s.env_type == EnvState::COLLISION) {
+            r.collision = true;
+            break;
+        }
+    }
+    return r;
+}
+
+}
+
+MapEvalReport evaluate_maps(const NativeActor& actor, const MapEvalConfig& config) {
+    project::env::MapGenerator generator(config.map);
+    std::vector<MapResult> results(config.maps);
+    project::common::ThreadPool pool(config.threads);
+
+    auto start = std::chrono::steady_clock::now();
+    pool.parallel_for(config.maps, [&](size_t i) {
+        // An exception must not escape: on a worker it would terminate, on the
+        // calling thread it would unwind while the workers still use this frame.
+        try {
+            NativeActor local = actor;
+            results[i] = run_map(local, generator, config.seed + i, config.max_steps);
+        } catch (const std::exception&) {
+            results[i].generated = false;
+        }
+    });
+
+    MapEvalReport report;
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.maps = config.maps;
+    for (const MapResult& r : results) {
+        if (!r.generated) report.failed_maps++;
+        report.steps += r.steps;
+        if (r.collision) report.collisions++;
+        if (r.success) {
+            report.successes++;
+            report.path_length += r.path;
+            if (r.straight > 0.0f) report.path_ratio += r.path / r.straight;
+        }
+    }
+    return report;
+}
+
+}
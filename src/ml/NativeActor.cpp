@@ -0,0 +1,247 @@
+#include "ml/NativeActor.hpp"
+#include "Consts.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace rl {
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x41504c52; // "RLPA"
+constexpr uint32_t VERSION = 1;
+// Upper bounds for what load() accepts from a file.
+constexpr uint32_t MAX_LAYERS = 64;
+constexpr uint32_t MAX_WIDTH = 1 << 16;
+
+// Rows are processed four at a time so every load of x feeds four dot products.
+constexpr int ROW_BLOCK = 4;
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+float hsum(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+void dot4(const float* w, int in, const float* x, float* out) {
+    const float* w0 = w;
+    const float* w1 = w + in;
+    const float* w2 = w + 2 * in;
+    const float* w3 = w + 3 * in;
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= in; i += 8) {
+        __m256 xv = _mm256_loadu_ps(x + i);
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(w0 + i), xv, s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(w1 + i), xv, s1);
+        s2 = _mm256_fmadd_ps(_mm256_loadu_ps(w2 + i), xv, s2);
+        s3 = _mm256_fmadd_ps(_mm256_loadu_ps(w3 + i), xv, s3);
+    }
+    out[0] = hsum(s0);
+    out[1] = hsum(s1);
+    out[2] = hsum(s2);
+    out[3] = hsum(s3);
+    for (; i < in; i++) {
+        out[0] += w0[i] * x[i];
+        out[1] += w1[i] * x[i];
+        out[2] += w2[i] * x[i];
+        out[3] += w3[i] * x[i];
+    }
+}
+
+#elif defined(__SSE2__)
+
+float hsum(__m128 s) {
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+void dot4(const float* w, int in, const float* x, float* out) {
+    const float* w0 = w;
+    const float* w1 = w + in;
+    const float* w2 = w + 2 * in;
+    const float* w3 = w + 3 * in;
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    __m128 s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= in; i += 4) {
+        __m128 xv = _mm_loadu_ps(x + i);
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(w0 + i), xv));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(w1 + i), xv));
+        s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(w2 + i), xv));
+        s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(w3 + i), xv));
+    }
+    out[0] = hsum(s0);
+    out[1] = hsum(s1);
+    out[2] = hsum(s2);
+    out[3] = hsum(s3);
+    for (; i < in; i++) {
+        out[0] += w0[i] * x[i];
+        out[1] += w1[i] * x[i];
+        out[2] += w2[i] * x[i];
+        out[3] += w3[i] * x[i];
+    }
+}
+
+#else
+
+void dot4(const float* w, int in, const float* x, float* out) {
+    out[0] = out[1] = out[2] = out[3] = 0.0f;
+    for (int i = 0; i < in; i++) {
+        out[0] += w[i] * x[i];
+        out[1] += w[in + i] * x[i];
+        out[2] += w[2 * in + i] * x[i];
+        out[3] += w[3 * in + i] * x[i];
+    }
+}
+
+#endif
+
+float dot(const float* w, int in, const float* x) {
+    float s = 0.0f;
+    for (int i = 0; i < in; i++) {
+        s += w[i] * x[i];
+    }
+    return s;
+}
+
+template <typename T>
+void write_pod(std::ofstream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+T read_pod(std::ifstream& in) {
+    T v;
+    in.read(reinterpret_cast<char*>(&v), sizeof(T));
+    return v;
+}
+
+}
+
+void dense_forward(const NativeActor::Layer& layer, const float* x, float* y, bool relu) {
+    const float* w = layer.weight.data();
+    int o = 0;
+    for (; o + ROW_BLOCK <= layer.out; o += ROW_BLOCK) {
+        dot4(w + static_cast<size_t>(o) * layer.in, layer.in, x, y + o);
+    }
+    for (; o < layer.out; o++) {
+        y[o] = dot(w + static_cast<size_t>(o) * layer.in, layer.in, x);
+    }
+    for (o = 0; o < layer.out; o++) {
+        float v = y[o] + layer.bias[o];
+        y[o] = relu ? std::max(v, 0.0f) : v;
+    }
+}
+
+NativeActor::NativeActor(std::vector<Layer> layers)
+    : layers_(std::make_shared<const std::vector<Layer>>(std::move(layers))) {
+    int width = 0;
+    for (const Layer& l : *layers_) {
+        width = std::max(width, l.out);
+    }
+    a_.resize(width);
+    b_.resize(width);
+}
+
+NativeActor NativeActor::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("NativeActor: cannot open " + path);
+    }
+    if (read_pod<uint32_t>(in) != MAGIC || read_pod<uint32_t>(in) != VERSION) {
+        throw std::runtime_error("NativeActor: " + path + " is not a version 1 actor file");
+    }
+    auto bad = [&](const std::string& why) {
+        return std::runtime_error("NativeActor: " + path + " " + why);
+    };
+    uint32_t count = read_pod<uint32_t>(in);
+    if (!in || count == 0 || count > MAX_LAYERS) {
+        throw bad("has an invalid layer count");
+    }
+    std::vector<Layer> layers(count);
+    uint32_t expected_in = project::common::TOTAL_OBS_SIZE;
+    for (Layer& l : layers) {
+        uint32_t out = read_pod<uint32_t>(in);
+        uint32_t width = read_pod<uint32_t>(in);
+        if (!in) {
+            throw bad("is truncated");
+        }
+        if (width != expected_in || out == 0 || out > MAX_WIDTH) {
+            throw bad("does not match the actor architecture");
+        }
+        l.out = static_cast<int>(out);
+        l.in = static_cast<int>(width);
+        l.weight.resize(static_cast<size_t>(l.out) * l.in);
+        l.bias.resize(l.out);
+        in.read(reinterpret_cast<char*>(l.weight.data()), l.weight.size() * sizeof(float));
+        in.read(reinterpret_cast<char*>(l.bias.data()), l.bias.size() * sizeof(float));
+        if (!in) {
+            throw bad("is truncated");
+        }
+        expected_in = out;
+    }
+    if (expected_in != project::common::ACT_SIZE) {
+        throw bad("does not match the actor architecture");
+    }
+    return NativeActor(std::move(layers));
+}
+
+void NativeActor::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    write_pod(out, MAGIC);
+    write_pod(out, VERSION);
+    write_pod(out, static_cast<uint32_t>(layers_->size()));
+    for (const Layer& l : *layers_) {
+        write_pod(out, static_cast<uint32_t>(l.out));
+        write_pod(out, static_cast<uint32_t>(l.in));
+        out.write(reinterpret_cast<const char*>(l.weight.data()), l.weight.size() * sizeof(float));
+        out.write(reinterpret_cast<const char*>(l.bias.data()), l.bias.size() * sizeof(float));
+    }
+    if (!out) {
+        throw std::runtime_error("NativeActor: cannot write " + path);
+    }
+}
+
+void NativeActor::forward(const float* obs, float* action) const {
+    const std::vector<Layer>& layers = *layers_;
+    const float* x = obs;
+    float* y = a_.data();
+    for (size_t l = 0; l + 1 < layers.size(); l++) {
+        dense_forward(layers[l], x, y, true);
+        x = y;
+        y = (y == a_.data()) ? b_.data() : a_.data();
+    }
+    const Layer& last = layers.back();
+    dense_forward(last, x, action, false);
+    for (int o = 0; o < last.out; o++) {
+        action[o] = std::tanh(action[o]);
+    }
+}
+
+const std::vector<NativeActor::Layer>& NativeActor::layers() const {
+    return *layers_;
+}
+
+int NativeActor::input_size() const {
+    return layers_->front().in;
+}
+
+int NativeActor::output_size() const {
+    return layers_->back().out;
+}
+
+}
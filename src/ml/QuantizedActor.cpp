@@ -0,0 +1,130 @@
+#include "ml/QuantizedActor.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace rl {
+
+namespace {
+
+int32_t dot_i8(const int8_t* w, const int8_t* x, int n) {
+    int i = 0;
+    int32_t s = 0;
+#if defined(__AVX2__)
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 16 <= n; i += 16) {
+        __m256i wv = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w + i)));
+        __m256i xv = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(wv, xv));
+    }
+    __m128i v = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    s = _mm_cvtsi128_si32(v);
+#elif defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i wv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + i));
+        __m128i xv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+        // Sign-extend int8 to int16 by placing each byte in the high half and shifting back.
+        __m128i w_lo = _mm_srai_epi16(_mm_unpacklo_epi8(wv, wv), 8);
+        __m128i w_hi = _mm_srai_epi16(_mm_unpackhi_epi8(wv, wv), 8);
+        __m128i x_lo = _mm_srai_epi16(_mm_unpacklo_epi8(xv, xv), 8);
+        __m128i x_hi = _mm_srai_epi16(_mm_unpackhi_epi8(xv, xv), 8);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(w_lo, x_lo));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(w_hi, x_hi));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    s = _mm_cvtsi128_si32(acc);
+#endif
+    for (; i < n; i++) {
+        s += static_cast<int32_t>(w[i]) * x[i];
+    }
+    return s;
+}
+
+void quantize(const float* x, int n, float scale, int8_t* q) {
+    float inv = scale > 0 ? 1.0f / scale : 0.0f;
+    for (int i = 0; i < n; i++) {
+        q[i] = static_cast<int8_t>(std::clamp(std::nearbyint(x[i] * inv), -127.0f, 127.0f));
+    }
+}
+
+float abs_max(const float* x, int n) {
+    float m = 0.0f;
+    for (int i = 0; i < n; i++) {
+        m = std::max(m, std::abs(x[i]));
+    }
+    return m;
+}
+
+}
+
+QuantizedActor QuantizedActor::calibrate(const NativeActor& actor, const float* states, size_t count) {
+    const std::vector<NativeActor::Layer>& src = actor.layers();
+    std::vector<float> input_max(src.size(), 0.0f);
+
+    int width = actor.input_size();
+    for (const NativeActor::Layer& l : src) {
+        width = std::max(width, l.out);
+    }
+    std::vector<float> a(width), b(width);
+    for (size_t k = 0; k < count; k++) {
+        std::copy(states + k * actor.input_size(), states + (k + 1) * actor.input_size(), a.begin());
+        for (size_t l = 0; l < src.size(); l++) {
+            input_max[l] = std::max(input_max[l], abs_max(a.data(), src[l].in));
+            dense_forward(src[l], a.data(), b.data(), l + 1 < src.size());
+            std::swap(a, b);
+        }
+    }
+
+    QuantizedActor q;
+    for (size_t l = 0; l < src.size(); l++) {
+        const NativeActor::Layer& s = src[l];
+        Layer d{s.out, s.in, input_max[l] / 127.0f, std::vector<int8_t>(s.weight.size()),
+                std::vector<float>(s.out), s.bias};
+        for (int o = 0; o < s.out; o++) {
+            const float* row = s.weight.data() + static_cast<size_t>(o) * s.in;
+            d.weight_scale[o] = abs_max(row, s.in) / 127.0f;
+            quantize(row, s.in, d.weight_scale[o], d.weight.data() + static_cast<size_t>(o) * s.in);
+        }
+        q.layers_.push_back(std::move(d));
+    }
+    q.q_.resize(width);
+    q.a_.resize(width);
+    q.b_.resize(width);
+    return q;
+}
+
+void QuantizedActor::forward(const float* obs, float* action) const {
+    const float* x = obs;
+    for (size_t l = 0; l < layers_.size(); l++) {
+        const Layer& layer = layers_[l];
+        bool last = l + 1 == layers_.size();
+        float* y = last ? action : (x == a_.data() ? b_.data() : a_.data());
+
+        quantize(x, layer.in, layer.input_scale, q_.data());
+        for (int o = 0; o < layer.out; o++) {
+            int32_t acc = dot_i8(layer.weight.data() + static_cast<size_t>(o) * layer.in, q_.data(), layer.in);
+            float v = acc * layer.weight_scale[o] * layer.input_scale + layer.bias[o];
+            y[o] = last ? std::tanh(v) : std::max(v, 0.0f);
+        }
+        x = y;
+    }
+}
+
+size_t QuantizedActor::weight_bytes() const {
+    size_t bytes = 0;
+    for (const Layer& l : layers_) {
+        bytes += l.weight.size() + (l.weight_scale.size() + l.bias.size() + 1) * sizeof(float);
+    }
+    return bytes;
+}
+
+}
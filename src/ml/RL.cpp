@@ -1,27 +1,320 @@
 #include "ml/RL.hpp"
 #include <torch/script.h>
+#include <torch/jit.h>
 #include <algorithm>
-#include <numeric>
+#include <cmath>
+#include <cstring>
 #include <ranges>
+#include <sstream>
+#include <stdexcept>
+#include "Telemetry.hpp"
 
 namespace rl {
 
-ReplayBuffer::ReplayBuffer(size_t capacity) : capacity_(capacity), rng(std::random_device{}()) {}
+void write_observation(const project::common::State& state, float max_distance, float* out) {
+    project::common::CompactState compact;
+    compact.obs = state.obs;
+    compact.direction_to_goal = {state.direction_to_goal.first, state.direction_to_goal.second};
+    compact.distance_to_goal = state.distance_to_goal;
+    compact.env_type = state.env_type;
+    project::env::Environment::write_observation(compact, max_distance, out);
+}
+
+ReplayBuffer::ReplayBuffer(size_t capacity, bool prioritized, float alpha, float beta)
+    : states_(torch::zeros({static_cast<int64_t>(capacity), TOTAL_OBS_SIZE})),
+      actions_(torch::zeros({static_cast<int64_t>(capacity), ACT_SIZE})),
+      rewards_(torch::zeros({static_cast<int64_t>(capacity)})),
+      next_states_(torch::zeros({static_cast<int64_t>(capacity), TOTAL_OBS_SIZE})),
+      dones_(torch::zeros({static_cast<int64_t>(capacity)})),
+      capacity_(capacity), rng(std::random_device{}()),
+      prioritized_(prioritized), alpha_(alpha), beta_start_(beta), beta_(beta), tree_(prioritized ? capacity : 0) {}
+
+ReplayBuffer::ReplayBuffer(const std::string& path, size_t capacity, bool prioritized, float alpha, float beta)
+    : ReplayBuffer(std::make_shared<ReplayFile>(path, capacity, TOTAL_OBS_SIZE, ACT_SIZE), prioritized, alpha, beta) {}
+
+ReplayBuffer::ReplayBuffer(std::shared_ptr<ReplayFile> file, bool prioritized, float alpha, float beta)
+    : file_(std::move(file)),
+      states_(torch::from_blob(file_->states(), {static_cast<int64_t>(file_->capacity()), TOTAL_OBS_SIZE})),
+      actions_(torch::from_blob(file_->actions(), {static_cast<int64_t>(file_->capacity()), ACT_SIZE})),
+      rewards_(torch::from_blob(file_->rewards(), {static_cast<int64_t>(file_->capacity())})),
+      next_states_(torch::from_blob(file_->next_states(), {static_cast<int64_t>(file_->capacity()), TOTAL_OBS_SIZE})),
+      dones_(torch::from_blob(file_->dones(), {static_cast<int64_t>(file_->capacity())})),
+      capacity_(file_->capacity()), size_(file_->header().size), pos_(file_->header().pos),
+      rng(std::random_device{}()),
+      prioritized_(prioritized), alpha_(alpha), beta_start_(beta), beta_(beta), tree_(prioritized ? capacity_ : 0) {
+    // The file holds no priorities: resumed transitions start out equally likely
+    // until a checkpoint restores them (set_priorities).
+    if (prioritized_) {
+        for (size_t i = 0; i < size_; ++i) {
+            tree_.set(i, std::pow(max_priority_, alpha_));
+        }
+    }
+}
 
 void ReplayBuffer::push(const Transition& t) {
-    if (buffer.size() >= capacity_) buffer.pop_front();
-    buffer.push_back(t);
+    auto state = t.state.to(torch::kFloat32).contiguous();
+    auto action = t.action.detach().to(torch::kFloat32).contiguous();
+    auto next_state = t.next_state.to(torch::kFloat32).contiguous();
+    push(state.data_ptr<float>(), action.data_ptr<float>(), t.reward.item<float>(),
+         next_state.data_ptr<float>(), t.done.item<float>() > 0.5f);
+}
+
+void ReplayBuffer::push(const float* state, const float* action, float reward, const float* next_state, bool done) {
+    RLPF_SCOPE("buffer_push");
+    std::memcpy(states_.data_ptr<float>() + pos_ * TOTAL_OBS_SIZE, state, TOTAL_OBS_SIZE * sizeof(float));
+    std::memcpy(actions_.data_ptr<float>() + pos_ * ACT_SIZE, action, ACT_SIZE * sizeof(float));
+    rewards_.data_ptr<float>()[pos_] = reward;
+    std::memcpy(next_states_.data_ptr<float>() + pos_ * TOTAL_OBS_SIZE, next_state, TOTAL_OBS_SIZE * sizeof(float));
+    dones_.data_ptr<float>()[pos_] = done ? 1.0f : 0.0f;
+    if (prioritized_) {
+        tree_.set(pos_, std::pow(max_priority_, alpha_));
+    }
+
+    pos_ = (pos_ + 1) % capacity_;
+    size_ = std::min(size_ + 1, capacity_);
+    if (file_) {
+        file_->header().pos = pos_;
+        file_->header().size = size_;
+    }
 }
 
-std::vector<Transition> ReplayBuffer::sample(size_t batch_size) {
-    std::vector<Transition> batch;
-    std::shuffle(buffer.begin(), buffer.end(), rng);
-    batch_size = std::min(batch_size, buffer.size());
-    batch.assign(buffer.begin(), buffer.begin() + batch_size);
-    return batch;
+Batch ReplayBuffer::sample(size_t batch_size) {
+    RLPF_SCOPE("buffer_sample");
+    if (size_ == 0) {
+        throw std::runtime_error("ReplayBuffer::sample: buffer is empty");
+    }
+    auto indices = torch::empty({static_cast<int64_t>(batch_size)}, torch::kInt64);
+    auto idx = indices.data_ptr<int64_t>();
+    torch::Tensor weights;
+
+    if (prioritized_) {
+        weights = torch::empty({static_cast<int64_t>(batch_size)});
+        auto w = weights.data_ptr<float>();
+        double total = tree_.total();
+        double segment = total / batch_size;
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        float max_w = 0.0f;
+        for (size_t i = 0; i < batch_size; ++i) {
+            size_t j = std::min(tree_.find((i + dist(rng)) * segment), size_ - 1);
+            idx[i] = static_cast<int64_t>(j);
+            w[i] = static_cast<float>(std::pow(size_ * tree_.get(j) / total, -beta_));
+            max_w = std::max(max_w, w[i]);
+        }
+        weights /= max_w;
+    } else {
+        std::uniform_int_distribution<int64_t> dist(0, static_cast<int64_t>(size_) - 1);
+        for (size_t i = 0; i < batch_size; ++i) {
+            idx[i] = dist(rng);
+        }
+    }
+
+    return {
+        states_.index_select(0, indices),
+        actions_.index_select(0, indices),
+        rewards_.index_select(0, indices),
+        next_states_.index_select(0, indices),
+        dones_.index_select(0, indices),
+        indices,
+        weights
+    };
+}
+
+void ReplayBuffer::update_priorities(const torch::Tensor& indices, const torch::Tensor& td_errors) {
+    if (!prioritized_) return;
+    auto idx = indices.contiguous();
+    auto td = td_errors.detach().to(torch::kFloat32).contiguous();
+    const int64_t* i = idx.data_ptr<int64_t>();
+    const float* e = td.data_ptr<float>();
+    for (int64_t k = 0; k < idx.numel(); ++k) {
+        float p = std::abs(e[k]) + 1e-6f;
+        max_priority_ = std::max(max_priority_, p);
+        tree_.set(static_cast<size_t>(i[k]), std::pow(p, alpha_));
+    }
+}
+
+void ReplayBuffer::save_contents(torch::serialize::OutputArchive& archive) const {
+    archive.write("capacity", torch::tensor(static_cast<int64_t>(capacity_)));
+    archive.write("size", torch::tensor(static_cast<int64_t>(size_)));
+    archive.write("pos", torch::tensor(static_cast<int64_t>(pos_)));
+    if (!file_) {
+        const int64_t n = static_cast<int64_t>(size_);
+        archive.write("states", states_.narrow(0, 0, n));
+        archive.write("actions", actions_.narrow(0, 0, n));
+        archive.write("rewards", rewards_.narrow(0, 0, n));
+        archive.write("next_states", next_states_.narrow(0, 0, n));
+        archive.write("dones", dones_.narrow(0, 0, n));
+    }
 }
 
-size_t ReplayBuffer::size() const { return buffer.size(); }
+void ReplayBuffer::load_contents(torch::serialize::InputArchive& archive) {
+    torch::Tensor capacity, size, pos;
+    archive.read("capacity", capacity);
+    archive.read("size", size);
+    archive.read("pos", pos);
+    if (capacity.item<int64_t>() != static_cast<int64_t>(capacity_)) {
+        throw std::runtime_error("replay capacity differs from the checkpoint");
+    }
+    const int64_t n = size.item<int64_t>();
+    torch::Tensor states;
+    if (archive.try_read("states", states)) {
+        torch::Tensor actions, rewards, next_states, dones;
+        archive.read("actions", actions);
+        archive.read("rewards", rewards);
+        archive.read("next_states", next_states);
+        archive.read("dones", dones);
+        states_.narrow(0, 0, n).copy_(states);
+        actions_.narrow(0, 0, n).copy_(actions);
+        rewards_.narrow(0, 0, n).copy_(rewards);
+        next_states_.narrow(0, 0, n).copy_(next_states);
+        dones_.narrow(0, 0, n).copy_(dones);
+    } else if (!file_) {
+        throw std::runtime_error("checkpoint was written with a replay file; pass the same file to resume");
+    }
+    size_ = static_cast<size_t>(n);
+    pos_ = static_cast<size_t>(pos.item<int64_t>());
+    if (file_) {
+        file_->header().size = size_;
+        file_->header().pos = pos_;
+    }
+    if (prioritized_) {
+        for (size_t i = 0; i < size_; ++i) {
+            tree_.set(i, std::pow(max_priority_, alpha_));
+        }
+    }
+}
+
+void ReplayBuffer::anneal_beta(double progress) {
+    beta_ = beta_start_ + (1.0f - beta_start_) * static_cast<float>(std::clamp(progress, 0.0, 1.0));
+}
+
+bool ReplayBuffer::prioritized() const { return prioritized_; }
+
+torch::Tensor ReplayBuffer::states() const {
+    return states_.narrow(0, 0, static_cast<int64_t>(size_));
+}
+
+size_t ReplayBuffer::size() const { return size_; }
+
+std::string ReplayBuffer::rng_state() const {
+    std::ostringstream out;
+    out << rng;
+    return out.str();
+}
+
+void ReplayBuffer::set_rng_state(const std::string& state) {
+    std::istringstream in(state);
+    in >> rng;
+}
+
+torch::Tensor ReplayBuffer::priorities() const {
+    if (!prioritized_) return torch::empty({0}, torch::kFloat64);
+    auto leaves = torch::empty({static_cast<int64_t>(size_)}, torch::kFloat64);
+    double* p = leaves.data_ptr<double>();
+    for (size_t i = 0; i < size_; ++i) {
+        p[i] = tree_.get(i);
+    }
+    return leaves;
+}
+
+float ReplayBuffer::max_priority() const { return max_priority_; }
+
+void ReplayBuffer::set_priorities(const torch::Tensor& leaves, float max_priority) {
+    if (!prioritized_) return;
+    max_priority_ = max_priority;
+    auto l = leaves.to(torch::kFloat64).contiguous();
+    const double* p = l.data_ptr<double>();
+    size_t n = std::min(static_cast<size_t>(l.numel()), size_);
+    for (size_t i = 0; i < n; ++i) {
+        tree_.set(i, p[i]);
+    }
+}
+
+ShardedReplayBuffer::ShardedReplayBuffer(size_t capacity, size_t num_shards) : rng(std::random_device{}()) {
+    num_shards = std::max<size_t>(num_shards, 1);
+    for (size_t i = 0; i < num_shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>((capacity + num_shards - 1) / num_shards));
+    }
+}
+
+void ShardedReplayBuffer::push(size_t shard, const float* state, const float* action, float reward, const float* next_state, bool done) {
+    Shard& s = *shards_[shard % shards_.size()];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.buffer.push(state, action, reward, next_state, done);
+    s.size.store(s.buffer.size(), std::memory_order_relaxed);
+}
+
+Batch ShardedReplayBuffer::sample(size_t batch_size) {
+    std::vector<double> weights;
+    weights.reserve(shards_.size());
+    for (const auto& s : shards_) {
+        weights.push_back(static_cast<double>(s->size.load(std::memory_order_relaxed)));
+    }
+    if (std::ranges::all_of(weights, [](double w) { return w == 0.0; })) {
+        throw std::runtime_error("ShardedReplayBuffer::sample: all shards are empty");
+    }
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+    std::vector<size_t> counts(shards_.size(), 0);
+    for (size_t i = 0; i < batch_size; ++i) {
+        counts[pick(rng)]++;
+    }
+
+    std::vector<torch::Tensor> states, actions, rewards, next_states, dones;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (counts[i] == 0) continue;
+        Batch part;
+        {
+            std::lock_guard<std::mutex> lock(shards_[i]->mutex);
+            part = shards_[i]->buffer.sample(counts[i]);
+        }
+        states.push_back(part.state);
+        actions.push_back(part.action);
+        rewards.push_back(part.reward);
+        next_states.push_back(part.next_state);
+        dones.push_back(part.done);
+    }
+    return {
+        torch::cat(states, 0),
+        torch::cat(actions, 0),
+        torch::cat(rewards, 0),
+        torch::cat(next_states, 0),
+        torch::cat(dones, 0)
+    };
+}
+
+size_t ShardedReplayBuffer::size() const {
+    size_t total = 0;
+    for (const auto& s : shards_) {
+        total += s->size.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+torch::Tensor flatten_parameters(torch::nn::Module& module) {
+    torch::NoGradGuard no_grad;
+    auto params = module.parameters();
+    int64_t total = 0;
+    for (const auto& p : params) {
+        total += p.numel();
+    }
+    auto flat = torch::empty({total}, torch::kFloat32);
+    int64_t offset = 0;
+    for (auto& p : params) {
+        auto view = flat.narrow(0, offset, p.numel()).view(p.sizes());
+        view.copy_(p);
+        p.set_data(view);
+        offset += p.numel();
+    }
+    return flat;
+}
+
+torch::Tensor add_exploration_noise(torch::Tensor action, float noise_std) {
+    if (noise_std > 0.0f) {
+        auto noise = torch::randn_like(action) * noise_std;
+        noise = noise.clamp(-0.5f, 0.5f);
+        action = (action + noise).clamp(-1.0f, 1.0f);
+    }
+    return action;
+}
 
 ActorNetImpl::ActorNetImpl() :
     fc1(TOTAL_OBS_SIZE, 512),
@@ -104,153 +397,385 @@ void CriticNetImpl::copy_weights(const CriticNetImpl& source) {
     }
 }
 
+TwinCriticImpl::TwinCriticImpl() {
+    // Initialise every head exactly like a standalone CriticNet.
+    CriticNetImpl heads[HEADS];
+    const torch::nn::Linear layers[] = {heads[0].fc1, heads[0].fc2, heads[0].fc3, heads[0].fc4, heads[0].fc5};
+    for (size_t l = 0; l < std::size(layers); ++l) {
+        weights.push_back(register_parameter("w" + std::to_string(l + 1),
+            torch::empty({HEADS, layers[l]->weight.size(0), layers[l]->weight.size(1)})));
+        biases.push_back(register_parameter("b" + std::to_string(l + 1),
+            torch::empty({HEADS, layers[l]->bias.size(0)})));
+    }
+    for (int64_t h = 0; h < HEADS; ++h) {
+        load_head(h, heads[h]);
+    }
+}
+
+torch::Tensor TwinCriticImpl::forward(torch::Tensor state, torch::Tensor action) {
+    auto x = torch::cat({state, action}, 1);
+    x = x.unsqueeze(0).expand({HEADS, x.size(0), x.size(1)});
+    for (size_t l = 0; l < weights.size(); ++l) {
+        x = torch::baddbmm(biases[l].unsqueeze(1), x, weights[l].transpose(1, 2));
+        if (l + 1 < weights.size()) {
+            x = torch::relu(x);
+        }
+    }
+    return x.squeeze(-1);
+}
+
+torch::Tensor TwinCriticImpl::q1(torch::Tensor state, torch::Tensor action) {
+    auto x = torch::cat({state, action}, 1);
+    for (size_t l = 0; l < weights.size(); ++l) {
+        x = torch::addmm(biases[l][0], x, weights[l][0].t());
+        if (l + 1 < weights.size()) {
+            x = torch::relu(x);
+        }
+    }
+    return x;
+}
+
+void TwinCriticImpl::copy_weights(const TwinCriticImpl& source) {
+    torch::NoGradGuard no_grad;
+    for (size_t l = 0; l < weights.size(); ++l) {
+        weights[l].copy_(source.weights[l]);
+        biases[l].copy_(source.biases[l]);
+    }
+}
+
+void TwinCriticImpl::load_head(int64_t head, const CriticNetImpl& critic) {
+    torch::NoGradGuard no_grad;
+    const torch::nn::Linear layers[] = {critic.fc1, critic.fc2, critic.fc3, critic.fc4, critic.fc5};
+    for (size_t l = 0; l < weights.size(); ++l) {
+        weights[l][head].copy_(layers[l]->weight);
+        biases[l][head].copy_(layers[l]->bias);
+    }
+}
+
+void TwinCriticImpl::store_head(int64_t head, CriticNetImpl& critic) const {
+    torch::NoGradGuard no_grad;
+    torch::nn::Linear layers[] = {critic.fc1, critic.fc2, critic.fc3, critic.fc4, critic.fc5};
+    for (size_t l = 0; l < weights.size(); ++l) {
+        layers[l]->weight.copy_(weights[l][head]);
+        layers[l]->bias.copy_(biases[l][head]);
+    }
+}
+
+// Same rule as torch::nn::utils::clip_grad_norm_, applied to each head separately.
+void TwinCriticImpl::clip_grad_norm_per_head(double max_norm) {
+    torch::NoGradGuard no_grad;
+    auto sq_norm = torch::zeros({HEADS});
+    for (const auto* group : {&weights, &biases}) {
+        for (const auto& p : *group) {
+            if (p.grad().defined()) {
+                sq_norm += p.grad().pow(2).reshape({HEADS, -1}).sum(1);
+            }
+        }
+    }
+    auto coef = (max_norm / (sq_norm.sqrt() + 1e-6)).clamp_max(1.0);
+    for (const auto* group : {&weights, &biases}) {
+        for (const auto& p : *group) {
+            if (p.grad().defined()) {
+                std::vector<int64_t> shape(p.dim(), 1);
+                shape[0] = HEADS;
+                p.grad().mul_(coef.view(shape));
+            }
+        }
+    }
+}
+
 TD3Agent::TD3Agent(float actor_lr, float critic_lr, float gamma_, float tau_, float max_distance_)
     : actor(std::make_shared<ActorNetImpl>()),
       actor_target(std::make_shared<ActorNetImpl>()),
-      critic1(std::make_shared<CriticNetImpl>()),
-      critic2(std::make_shared<CriticNetImpl>()),
-      critic1_target(std::make_shared<CriticNetImpl>()),
-      critic2_target(std::make_shared<CriticNetImpl>()),
+      critic(std::make_shared<TwinCriticImpl>()),
+      critic_target(std::make_shared<TwinCriticImpl>()),
       actor_optimizer(actor->parameters(), actor_lr),
-      critic1_optimizer(critic1->parameters(), critic_lr),
-      critic2_optimizer(critic2->parameters(), critic_lr),
+      critic_optimizer(critic->parameters(), critic_lr),
       gamma(gamma_), tau(tau_), max_distance(max_distance_), update_step(0), policy_delay(4) {
 
     actor_target->copy_weights(*actor);
-    critic1_target->copy_weights(*critic1);
-    critic2_target->copy_weights(*critic2);
+    critic_target->copy_weights(*critic);
 
     for (auto& param : actor_target->parameters()) {
         param.set_requires_grad(false);
     }
-    for (auto& param : critic1_target->parameters()) {
+    for (auto& param : critic_target->parameters()) {
         param.set_requires_grad(false);
     }
-    for (auto& param : critic2_target->parameters()) {
-        param.set_requires_grad(false);
+
+    actor_params = actor->parameters();
+    flatten();
+}
+
+namespace {
+
+// Mirrors ActorNetImpl::forward, add_exploration_noise's clamp and
+// TwinCriticImpl::forward; weights are passed per layer in forward order.
+const char* TD3_TARGET_SCRIPT = R"JIT(
+def td3_target(next_state: Tensor, reward: Tensor, done: Tensor, noise: Tensor, gamma: float,
+               actor_w: List[Tensor], actor_b: List[Tensor],
+               critic_w: List[Tensor], critic_b: List[Tensor]) -> Tensor:
+    x = next_state
+    for l in range(len(actor_w)):
+        x = torch.addmm(actor_b[l], x, actor_w[l].t())
+        if l + 1 < len(actor_w):
+            x = torch.relu(x)
+    action = torch.clamp(torch.tanh(x) + noise, -1.0, 1.0)
+    h = torch.cat([next_state, action], 1)
+    h = h.unsqueeze(0).expand([critic_w[0].size(0), h.size(0), h.size(1)])
+    for l in range(len(critic_w)):
+        h = torch.baddbmm(critic_b[l].unsqueeze(1), h, critic_w[l].transpose(1, 2))
+        if l + 1 < len(critic_w):
+            h = torch.relu(h)
+    q = torch.min(h.squeeze(-1), 0)[0]
+    return reward + gamma * (1.0 - done) * q
+)JIT";
+
+c10::List<torch::Tensor> tensor_list(const std::vector<torch::Tensor>& tensors) {
+    c10::List<torch::Tensor> list;
+    list.reserve(tensors.size());
+    for (const auto& t : tensors) {
+        list.push_back(t);
     }
+    return list;
 }
 
-torch::Tensor TD3Agent::preprocess_state(const project::common::State& state) {
-    std::vector<float> obs_data;
-    obs_data.reserve(TOTAL_OBS_SIZE);
+}
 
-    obs_data.insert(obs_data.end(), state.obs.begin(), state.obs.end());
-    obs_data.push_back(state.direction_to_goal.first);
-    obs_data.push_back(state.direction_to_goal.second);
-    obs_data.push_back(state.distance_to_goal / max_distance);
+void TD3Agent::set_scripted_target(bool enabled) {
+    target_script = enabled ? torch::jit::compile(TD3_TARGET_SCRIPT) : nullptr;
+}
 
-    return torch::tensor(obs_data, torch::kFloat32).reshape({1, TOTAL_OBS_SIZE});
+torch::Tensor TD3Agent::target_value(const Batch& batch) {
+    torch::NoGradGuard no_grad;
+    torch::Tensor noise = (torch::randn_like(batch.action) * 0.2f).clamp(-0.5f, 0.5f);
+    if (target_script) {
+        const ActorNetImpl& a = *actor_target;
+        std::vector<c10::IValue> stack{
+            batch.next_state, batch.reward, batch.done, noise, static_cast<double>(gamma),
+            tensor_list({a.fc1->weight, a.fc2->weight, a.fc3->weight, a.fc4->weight, a.fc5->weight}),
+            tensor_list({a.fc1->bias, a.fc2->bias, a.fc3->bias, a.fc4->bias, a.fc5->bias}),
+            tensor_list(critic_target->weights),
+            tensor_list(critic_target->biases)
+        };
+        return target_script->get_function("td3_target")(std::move(stack)).toTensor();
+    }
+    auto next_actions = (actor_target->forward(batch.next_state) + noise).clamp(-1.0f, 1.0f);
+    auto target_q = std::get<0>(critic_target->forward(batch.next_state, next_actions).min(0));
+    return batch.reward + gamma * (1.0f - batch.done) * target_q;
+}
+
+void TD3Agent::flatten() {
+    actor_flat = flatten_parameters(*actor);
+    actor_target_flat = flatten_parameters(*actor_target);
+    critic_flat = flatten_parameters(*critic);
+    critic_target_flat = flatten_parameters(*critic_target);
+}
+
+torch::Tensor TD3Agent::preprocess_state(const project::common::State& state) {
+    RLPF_SCOPE("preprocess");
+    auto obs = torch::empty({1, TOTAL_OBS_SIZE}, torch::kFloat32);
+    write_observation(state, max_distance, obs.data_ptr<float>());
+    return obs;
 }
 
 std::pair<torch::Tensor, torch::Tensor> TD3Agent::select_action(torch::Tensor state, float noise_std) {
+    RLPF_SCOPE("select_action");
     actor->eval();
     torch::NoGradGuard no_grad;
-    auto action = actor->forward(state);
-
-    if (noise_std > 0.0f) {
-        auto noise = torch::randn_like(action) * noise_std;
-        noise = noise.clamp(-0.5f, 0.5f);
-        action = (action + noise).clamp(-1.0f, 1.0f);
-    }
+    auto action = add_exploration_noise(actor->forward(state), noise_std);
 
     actor->train();
     return {action, action.norm(2, 1, true)};
 }
 
-void TD3Agent::soft_update(torch::nn::Module& target, const torch::nn::Module& source) {
-    torch::NoGradGuard no_grad;
-    for (const auto& tp : target.named_parameters()) {
-        const auto& sp = source.named_parameters()[tp.key()];
-        tp.value().data().mul_(1.0f - tau).add_(sp.data(), tau);
-    }
-}
-
 void TD3Agent::update(ReplayBuffer& buffer, int batch_size) {
     if (buffer.size() < batch_size) return;
-
     auto batch = buffer.sample(batch_size);
+    auto td_errors = update(batch);
+    buffer.update_priorities(batch.indices, td_errors);
+}
 
-    std::vector<torch::Tensor> states, actions, rewards, next_states, dones;
-    for (const auto& t : batch) {
-        states.push_back(t.state);
-        actions.push_back(t.action.detach());
-        rewards.push_back(t.reward);
-        next_states.push_back(t.next_state);
-        dones.push_back(t.done);
-    }
-
-    auto state_batch = torch::cat(states, 0);
-    auto action_batch = torch::cat(actions, 0);
-    auto reward_batch = torch::cat(rewards, 0).squeeze(-1);
-    auto next_state_batch = torch::cat(next_states, 0);
-    auto done_batch = torch::cat(dones, 0).squeeze(-1);
-
-    torch::Tensor next_action_noise = torch::randn_like(action_batch) * 0.2f;
-    next_action_noise = next_action_noise.clamp(-0.5f, 0.5f);
-    auto next_actions = actor_target->forward(next_state_batch) + next_action_noise;
-    next_actions = next_actions.clamp(-1.0f, 1.0f);
-
-    auto target_q1 = critic1_target->forward(next_state_batch, next_actions);
-    auto target_q2 = critic2_target->forward(next_state_batch, next_actions);
-    auto target_q = torch::min(target_q1, target_q2);
-    auto target_value = reward_batch + gamma * (1.0f - done_batch) * target_q.squeeze();
-
-    auto current_q1 = critic1->forward(state_batch, action_batch).squeeze();
-    auto current_q2 = critic2->forward(state_batch, action_batch).squeeze();
-
-    auto critic1_loss = torch::mse_loss(current_q1, target_value.detach());
-    auto critic2_loss = torch::mse_loss(current_q2, target_value.detach());
-
-    critic1_optimizer.zero_grad();
-    critic1_loss.backward();
-    torch::nn::utils::clip_grad_norm_(critic1->parameters(), 1.0);
-    critic1_optimizer.step();
-
-    critic2_optimizer.zero_grad();
-    critic2_loss.backward();
-    torch::nn::utils::clip_grad_norm_(critic2->parameters(), 1.0);
-    critic2_optimizer.step();
-
-    if (++update_step % policy_delay == 0) {
-        auto actor_loss = -critic1->forward(state_batch, actor->forward(state_batch)).mean();
+void TD3Agent::update_batched(ReplayBuffer& buffer, int batch_size, int updates) {
+    if (buffer.size() < batch_size || updates < 1) return;
+    auto mega = buffer.sample(static_cast<size_t>(batch_size) * updates);
+    // PER draws row i from the i-th stratum of the sum tree, so consecutive rows
+    // come from neighbouring stretches of the ring. Shuffle once so that every
+    // slice is a representative batch.
+    if (updates > 1) {
+        auto perm = torch::randperm(mega.state.size(0), torch::kInt64);
+        mega.state = mega.state.index_select(0, perm);
+        mega.action = mega.action.index_select(0, perm);
+        mega.reward = mega.reward.index_select(0, perm);
+        mega.next_state = mega.next_state.index_select(0, perm);
+        mega.done = mega.done.index_select(0, perm);
+        mega.indices = mega.indices.index_select(0, perm);
+        if (mega.weights.defined()) {
+            mega.weights = mega.weights.index_select(0, perm);
+        }
+    }
+    std::vector<torch::Tensor> td_errors;
+    td_errors.reserve(updates);
+    for (int k = 0; k < updates; ++k) {
+        const int64_t start = static_cast<int64_t>(k) * batch_size;
+        Batch slice{
+            mega.state.narrow(0, start, batch_size),
+            mega.action.narrow(0, start, batch_size),
+            mega.reward.narrow(0, start, batch_size),
+            mega.next_state.narrow(0, start, batch_size),
+            mega.done.narrow(0, start, batch_size),
+            mega.indices.narrow(0, start, batch_size),
+            torch::Tensor()
+        };
+        if (mega.weights.defined()) {
+            // Importance weights are normalised per batch, as in sample().
+            auto w = mega.weights.narrow(0, start, batch_size);
+            slice.weights = w / w.max();
+        }
+        td_errors.push_back(update(slice));
+    }
+    buffer.update_priorities(mega.indices, torch::cat(td_errors));
+}
 
-        actor_optimizer.zero_grad();
-        actor_loss.backward();
-        torch::nn::utils::clip_grad_norm_(actor->parameters(), 1.0);
-        actor_optimizer.step();
+torch::Tensor TD3Agent::update(const Batch& batch) {
+    RLPF_SCOPE("update");
+    RLPF_COUNT("updates", 1);
+    const auto& state_batch = batch.state;
+    const auto& action_batch = batch.action;
+
+    torch::Tensor td, critic_loss;
+    {
+        RLPF_SCOPE("critic_forward");
+        auto target = target_value(batch);
+        auto current_q = critic->forward(state_batch, action_batch);
+
+        // The heads share no parameters, so the summed loss gives each head exactly
+        // the gradient of its own MSE.
+        td = current_q - target;
+        auto sq = td.pow(2);
+        if (batch.weights.defined()) {
+            sq = sq * batch.weights;
+        }
+        critic_loss = sq[0].mean() + sq[1].mean();
+    }
+    {
+        RLPF_SCOPE("critic_backward");
+        critic_optimizer.zero_grad();
+        critic_loss.backward();
+        critic->clip_grad_norm_per_head(1.0);
+        critic_optimizer.step();
+    }
 
-        soft_update(*actor_target, *actor);
-        soft_update(*critic1_target, *critic1);
-        soft_update(*critic2_target, *critic2);
+    if (++update_step % policy_delay == 0) {
+        torch::Tensor actor_loss;
+        {
+            RLPF_SCOPE("actor_forward");
+            actor_loss = -critic->q1(state_batch, actor->forward(state_batch)).mean();
+        }
+        {
+            RLPF_SCOPE("actor_backward");
+            actor_optimizer.zero_grad();
+            actor_loss.backward();
+            torch::nn::utils::clip_grad_norm_(actor_params, 1.0);
+            actor_optimizer.step();
+        }
+
+        // Polyak averaging, one vectorized lerp per network over its flat buffer.
+        RLPF_SCOPE("target_update");
+        torch::NoGradGuard no_grad;
+        actor_target_flat.lerp_(actor_flat, tau);
+        critic_target_flat.lerp_(critic_flat, tau);
     }
+
+    return std::get<0>(td.detach().abs().max(0));
 }
 
 void TD3Agent::save_model(const std::string& actor_path, const std::string& critic1_path, const std::string& critic2_path) {
+    CriticNet critic1(std::make_shared<CriticNetImpl>());
+    CriticNet critic2(std::make_shared<CriticNetImpl>());
+    critic->store_head(0, *critic1);
+    critic->store_head(1, *critic2);
+
     torch::save(actor, actor_path);
     torch::save(critic1, critic1_path);
     torch::save(critic2, critic2_path);
 }
 
 void TD3Agent::load_model(const std::string& actor_path, const std::string& critic1_path, const std::string& critic2_path) {
+    CriticNet critic1(std::make_shared<CriticNetImpl>());
+    CriticNet critic2(std::make_shared<CriticNetImpl>());
+
     torch::load(actor, actor_path);
     torch::load(critic1, critic1_path);
     torch::load(critic2, critic2_path);
+    critic->load_head(0, *critic1);
+    critic->load_head(1, *critic2);
 
     actor_target->copy_weights(*actor);
-    critic1_target->copy_weights(*critic1);
-    critic2_target->copy_weights(*critic2);
+    critic_target->copy_weights(*critic);
+    flatten();
+}
+
+void TD3Agent::save_checkpoint(torch::serialize::OutputArchive& archive) {
+    auto write = [&](const char* key, auto&& saveable) {
+        torch::serialize::OutputArchive sub;
+        saveable.save(sub);
+        archive.write(key, sub);
+    };
+    write("actor", *actor);
+    write("actor_target", *actor_target);
+    write("critic", *critic);
+    write("critic_target", *critic_target);
+    write("actor_optimizer", actor_optimizer);
+    write("critic_optimizer", critic_optimizer);
+    archive.write("update_step", torch::tensor(static_cast<int64_t>(update_step)));
+}
+
+void TD3Agent::load_checkpoint(torch::serialize::InputArchive& archive) {
+    auto read = [&](const char* key, auto&& loadable) {
+        torch::serialize::InputArchive sub;
+        archive.read(key, sub);
+        loadable.load(sub);
+    };
+    read("actor", *actor);
+    read("actor_target", *actor_target);
+    read("critic", *critic);
+    read("critic_target", *critic_target);
+    read("actor_optimizer", actor_optimizer);
+    read("critic_optimizer", critic_optimizer);
+    torch::Tensor step;
+    archive.read("update_step", step);
+    update_step = static_cast<int>(step.item<int64_t>());
+    flatten();
+}
+
+void TD3Agent::export_actor(const std::string& path) {
+    native_actor().save(path);
+}
+
+NativeActor TD3Agent::native_actor() {
+    torch::NoGradGuard no_grad;
+    std::vector<NativeActor::Layer> layers;
+    for (const torch::nn::Linear& fc : {actor->fc1, actor->fc2, actor->fc3, actor->fc4, actor->fc5}) {
+        auto w = fc->weight.detach().to(torch::kFloat32).contiguous();
+        auto b = fc->bias.detach().to(torch::kFloat32).contiguous();
+        layers.push_back({
+            static_cast<int>(w.size(0)),
+            static_cast<int>(w.size(1)),
+            std::vector<float>(w.data_ptr<float>(), w.data_ptr<float>() + w.numel()),
+            std::vector<float>(b.data_ptr<float>(), b.data_ptr<float>() + b.numel())
+        });
+    }
+    return NativeActor(std::move(layers));
 }
 
 void TD3Agent::set_eval_mode(bool eval) {
     if (eval) {
         actor->eval();
-        critic1->eval();
-        critic2->eval();
+        critic->eval();
     } else {
         actor->train();
-        critic1->train();
-        critic2->train();
+        critic->train();
     }
 }
 
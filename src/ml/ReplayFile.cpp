@@ -0,0 +1,111 @@
+#include "ml/ReplayFile.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rl {
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x42504c52; // "RLPB"
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_BYTES = 4096;
+constexpr size_t COLUMN_ALIGN = 64;
+
+size_t align_up(size_t n, size_t a) {
+    return (n + a - 1) / a * a;
+}
+
+std::runtime_error io_error(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+}
+
+ReplayFile::ReplayFile(const std::string& path, size_t capacity, uint32_t obs_size, uint32_t act_size) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw io_error("cannot open replay file", path);
+    }
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        ::close(fd_);
+        throw io_error("cannot stat replay file", path);
+    }
+
+    Header existing{};
+    bool fresh = st.st_size == 0;
+    if (!fresh) {
+        if (::pread(fd_, &existing, sizeof(existing), 0) != sizeof(existing) || existing.magic != MAGIC
+            || existing.version != VERSION || existing.obs_size != obs_size || existing.act_size != act_size) {
+            ::close(fd_);
+            throw std::runtime_error("incompatible replay file " + path);
+        }
+        if (existing.capacity == 0 || existing.size > existing.capacity || existing.pos >= existing.capacity) {
+            ::close(fd_);
+            throw std::runtime_error("corrupt replay file header in " + path);
+        }
+        capacity = existing.capacity;
+    }
+
+    const size_t widths[5] = {obs_size, act_size, 1, obs_size, 1};
+    size_t offset = HEADER_BYTES;
+    for (int i = 0; i < 5; ++i) {
+        offsets_[i] = offset;
+        offset = align_up(offset + capacity * widths[i] * sizeof(float), COLUMN_ALIGN);
+    }
+    bytes_ = offset;
+
+    if (static_cast<size_t>(st.st_size) < bytes_ && ::ftruncate(fd_, static_cast<off_t>(bytes_)) != 0) {
+        ::close(fd_);
+        throw io_error("cannot size replay file", path);
+    }
+
+    base_ = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (base_ == MAP_FAILED) {
+        base_ = nullptr;
+        ::close(fd_);
+        throw io_error("cannot map replay file", path);
+    }
+    // Sampling touches rows uniformly at random; readahead would only waste cache.
+    ::madvise(base_, bytes_, MADV_RANDOM);
+
+    if (fresh) {
+        header() = {MAGIC, VERSION, obs_size, act_size, capacity, 0, 0};
+    }
+}
+
+ReplayFile::~ReplayFile() {
+    if (base_) {
+        ::msync(base_, bytes_, MS_SYNC);
+        ::munmap(base_, bytes_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+ReplayFile::Header& ReplayFile::header() {
+    return *static_cast<Header*>(base_);
+}
+
+size_t ReplayFile::capacity() const {
+    return static_cast<const Header*>(base_)->capacity;
+}
+
+float* ReplayFile::column(int i) {
+    return reinterpret_cast<float*>(static_cast<char*>(base_) + offsets_[i]);
+}
+
+float* ReplayFile::states() { return column(0); }
+float* ReplayFile::actions() { return column(1); }
+float* ReplayFile::rewards() { return column(2); }
+float* ReplayFile::next_states() { return column(3); }
+float* ReplayFile::dones() { return column(4); }
+
+}
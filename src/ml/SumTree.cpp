@@ -0,0 +1,36 @@
+#include "ml/SumTree.hpp"
+
+namespace rl {
+
+SumTree::SumTree(size_t capacity) : leaves_(1) {
+    while (leaves_ < capacity) leaves_ <<= 1;
+    nodes_.assign(2 * leaves_, 0.0);
+}
+
+void SumTree::set(size_t i, double priority) {
+    size_t node = i + leaves_;
+    double delta = priority - nodes_[node];
+    for (; node > 0; node >>= 1) {
+        nodes_[node] += delta;
+    }
+}
+
+double SumTree::get(size_t i) const { return nodes_[i + leaves_]; }
+
+double SumTree::total() const { return nodes_[1]; }
+
+size_t SumTree::find(double mass) const {
+    size_t node = 1;
+    while (node < leaves_) {
+        size_t left = 2 * node;
+        if (mass < nodes_[left] || nodes_[left + 1] <= 0.0) {
+            node = left;
+        } else {
+            mass -= nodes_[left];
+            node = left + 1;
+        }
+    }
+    return node - leaves_;
+}
+
+}
@@ -0,0 +1,95 @@
+#include "ml/VecEnv.hpp"
+#include "ml/RL.hpp"
+#include <cstring>
+
+namespace rl {
+
+StepReward compute_reward(const project::common::CompactState& prev, const project::common::CompactState& next, float max_distance) {
+    using project::common::EnvState;
+    switch (next.env_type) {
+        case EnvState::TERMINAL:
+            return {500.0f, true};
+        case EnvState::COLLISION:
+            return {-100.0f, true};
+        case EnvState::TIMEOUT:
+            return {-5.0f, true};
+        default:
+            float reward = -0.001f;
+            float progress = (prev.distance_to_goal - next.distance_to_goal) / max_distance;
+            reward += 30.0f * progress;
+            if (progress > 0.0f) reward += max_distance *
+                (1.0f / next.distance_to_goal - 1.0f / prev.distance_to_goal);
+            return {reward, false};
+    }
+}
+
+VecEnvironment::VecEnvironment(const project::env::Environment& proto, size_t num_envs, int max_steps, float max_distance,
+                               size_t num_threads, std::vector<int> worker_cpus)
+    : envs_(num_envs, proto), start_states_(num_envs), steps_(num_envs, 0),
+      max_steps_(max_steps), max_distance_(max_distance) {
+    const int64_t n = static_cast<int64_t>(num_envs);
+    for (auto& res : out_) {
+        res.obs = torch::empty({n, TOTAL_OBS_SIZE});
+        res.next_obs = torch::empty({n, TOTAL_OBS_SIZE});
+        res.reward = torch::empty({n});
+        res.done = torch::empty({n});
+        res.env_type.resize(num_envs);
+        res.finished.resize(num_envs);
+    }
+    if (num_threads > 1) {
+        pool_ = std::make_unique<project::common::ThreadPool>(num_threads, std::move(worker_cpus));
+    }
+}
+
+torch::Tensor VecEnvironment::reset() {
+    auto obs = torch::empty({static_cast<int64_t>(envs_.size()), TOTAL_OBS_SIZE});
+    float* out = obs.data_ptr<float>();
+    for (size_t i = 0; i < envs_.size(); ++i) {
+        start_states_[i] = envs_[i].restart(out + i * TOTAL_OBS_SIZE);
+        steps_[i] = 0;
+    }
+    return obs;
+}
+
+void VecEnvironment::step_one(size_t i, const float* a, VecStep& res) {
+    float* obs = res.obs.data_ptr<float>() + i * TOTAL_OBS_SIZE;
+    float* next_obs = res.next_obs.data_ptr<float>() + i * TOTAL_OBS_SIZE;
+
+    project::common::Action action{{a[i * ACT_SIZE], a[i * ACT_SIZE + 1]}, 1.0f};
+    project::common::CompactState s2 = envs_[i].step(action, next_obs);
+    // Progress is measured from the episode start, as in the single-env loop in main.cpp.
+    StepReward r = compute_reward(start_states_[i], s2, max_distance_);
+
+    res.reward.data_ptr<float>()[i] = r.reward;
+    res.done.data_ptr<float>()[i] = r.done ? 1.0f : 0.0f;
+    res.env_type[i] = s2.env_type;
+
+    if (r.done || ++steps_[i] >= max_steps_) {
+        res.finished[i] = 1;
+        start_states_[i] = envs_[i].restart(obs);
+        steps_[i] = 0;
+    } else {
+        res.finished[i] = 0;
+        std::memcpy(obs, next_obs, TOTAL_OBS_SIZE * sizeof(float));
+    }
+}
+
+const VecStep& VecEnvironment::step(const torch::Tensor& actions) {
+    auto act = actions.detach().to(torch::kFloat32).contiguous();
+    const float* a = act.data_ptr<float>();
+    VecStep& res = out_[cur_];
+    cur_ ^= 1;
+
+    if (pool_) {
+        pool_->parallel_for(envs_.size(), [&](size_t i) { step_one(i, a, res); });
+    } else {
+        for (size_t i = 0; i < envs_.size(); ++i) {
+            step_one(i, a, res);
+        }
+    }
+    return res;
+}
+
+size_t VecEnvironment::size() const { return envs_.size(); }
+
+}